@@ -0,0 +1,396 @@
+#include "BatchGame.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include "Search.hpp"
+
+// Cells of a field, by column from the left and every column from the
+// bottom up, the order RGB_Game::choose_move scans them in
+#define BATCH_CELLS (FIELD_HEIGHT * FIELD_WIDTH)
+
+namespace RGB_Game {
+
+#if defined(__GNUC__) || defined(__clang__)
+
+// A byte of every game of a block
+typedef std::uint8_t Lanes __attribute__((vector_size(BATCH_LANES)));
+
+static Lanes broadcast(std::uint8_t value) { return Lanes{} + value; }
+
+// The comparisons set all bits of the lanes where they hold
+static Lanes equal(Lanes a, Lanes b) { return (Lanes)(a == b); }
+static Lanes greater(Lanes a, Lanes b) { return (Lanes)(a > b); }
+
+#else
+
+// A byte of every game of a block
+struct Lanes {
+  std::uint8_t lane[BATCH_LANES] = {};
+};
+
+#define LANES_OPERATOR(op)                              \
+  static Lanes operator op(Lanes a, Lanes b) {          \
+    for (std::size_t g = 0; g < BATCH_LANES; g++) {     \
+      a.lane[g] = static_cast<std::uint8_t>(a.lane[g] op b.lane[g]); \
+    }                                                   \
+    return a;                                           \
+  }
+LANES_OPERATOR(&)
+LANES_OPERATOR(|)
+LANES_OPERATOR(^)
+LANES_OPERATOR(-)
+#undef LANES_OPERATOR
+
+static Lanes operator~(Lanes a) {
+  for (auto &lane : a.lane) {
+    lane = static_cast<std::uint8_t>(~lane);
+  }
+  return a;
+}
+
+static Lanes broadcast(std::uint8_t value) {
+  Lanes result;
+  std::memset(result.lane, value, BATCH_LANES);
+  return result;
+}
+
+// The comparisons set all bits of the lanes where they hold
+static Lanes equal(Lanes a, Lanes b) {
+  for (std::size_t g = 0; g < BATCH_LANES; g++) {
+    a.lane[g] = a.lane[g] == b.lane[g] ? 0xFF : 0;
+  }
+  return a;
+}
+
+static Lanes greater(Lanes a, Lanes b) {
+  for (std::size_t g = 0; g < BATCH_LANES; g++) {
+    a.lane[g] = a.lane[g] > b.lane[g] ? 0xFF : 0;
+  }
+  return a;
+}
+
+#endif
+
+static_assert(BATCH_LANES % 8 == 0, "The lanes must fill whole words");
+
+// Label of an empty cell, and of no move
+static const std::uint8_t no_label = 0xFF;
+
+static_assert(BATCH_CELLS + FIELD_WIDTH <= no_label,
+              "A label must fit in a byte");
+
+static Lanes select(Lanes mask, Lanes a, Lanes b) {
+  return (mask & a) | (~mask & b);
+}
+
+static Lanes minimum(Lanes a, Lanes b) { return select(greater(a, b), b, a); }
+
+/**
+ * @brief Tells whether any lane has a bit set.
+ */
+static bool any(Lanes mask) {
+  std::uint64_t words[BATCH_LANES / 8];
+  std::memcpy(words, &mask, sizeof(words));
+  std::uint64_t bits = 0;
+  for (auto word : words) {
+    bits |= word;
+  }
+  return bits != 0;
+}
+
+/**
+ * @brief The games of a block, structure-of-arrays.
+ */
+struct BatchBlock {
+  Lanes balls[BATCH_CELLS];   // colour 1, 2 or 3, or 0 for an empty cell
+  Lanes labels[BATCH_CELLS];  // the cluster of every ball
+};
+
+/**
+ * @brief Labels every ball by the least key of its cluster.
+ *
+ * The key of a cell is its index, or, in the top row, which choose_move
+ * never picks, a number above all indices. The label of a cluster with a
+ * ball below the top row is therefore the first cell choose_move visits.
+ * The keys spread by a sweep from the bottom left and a sweep from the top
+ * right until no label changes in any game.
+ */
+static void label_clusters(BatchBlock &block) {
+  Lanes empty = broadcast(0);
+  for (std::size_t c = 0; c < BATCH_CELLS; c++) {
+    std::size_t key = c % FIELD_HEIGHT == FIELD_HEIGHT - 1
+                          ? BATCH_CELLS + c / FIELD_HEIGHT
+                          : c;
+    block.labels[c] = select(equal(block.balls[c], empty),
+                             broadcast(no_label),
+                             broadcast(static_cast<std::uint8_t>(key)));
+  }
+
+  // Takes the label of a neighbour of the same colour if it is less; the
+  // empty cells are all labelled no_label
+  auto join = [&](Lanes label, std::size_t c, std::size_t neighbour) {
+    return select(equal(block.balls[c], block.balls[neighbour]),
+                  minimum(label, block.labels[neighbour]), label);
+  };
+
+  bool changed = true;
+  while (changed) {
+    Lanes changes = broadcast(0);
+    for (std::size_t c = 0; c < BATCH_CELLS; c++) {
+      Lanes label = block.labels[c];
+      if (c % FIELD_HEIGHT) label = join(label, c, c - 1);
+      if (c >= FIELD_HEIGHT) label = join(label, c, c - FIELD_HEIGHT);
+      changes = changes | (label ^ block.labels[c]);
+      block.labels[c] = label;
+    }
+    for (std::size_t c = BATCH_CELLS; c-- > 0;) {
+      Lanes label = block.labels[c];
+      if (c % FIELD_HEIGHT != FIELD_HEIGHT - 1) {
+        label = join(label, c, c + 1);
+      }
+      if (c + FIELD_HEIGHT < BATCH_CELLS) {
+        label = join(label, c, c + FIELD_HEIGHT);
+      }
+      changes = changes | (label ^ block.labels[c]);
+      block.labels[c] = label;
+    }
+    changed = any(changes);
+  }
+}
+
+/**
+ * @brief Chooses the move of every game as RGB_Game::choose_move does.
+ *
+ * The labels come in the order the scan visits the clusters, so a cluster
+ * replaces the best one only if it is larger.
+ *
+ * @param best_label Receives the label of the cluster to remove, or
+ * no_label if a game has no move.
+ * @param best_size Receives the size of the cluster.
+ */
+static void choose_moves(const BatchBlock &block, Lanes &best_label,
+                         Lanes &best_size) {
+  best_label = broadcast(no_label);
+  best_size = broadcast(2);
+  for (std::size_t anchor = 0; anchor < BATCH_CELLS; anchor++) {
+    Lanes key = broadcast(static_cast<std::uint8_t>(anchor));
+    if (anchor % FIELD_HEIGHT == FIELD_HEIGHT - 1 ||
+        !any(equal(block.labels[anchor], key))) {
+      continue;
+    }
+
+    // Before its anchor a cluster has balls only in the top row; a lane
+    // which holds gains 1 by subtracting all bits set
+    Lanes size = broadcast(0);
+    for (std::size_t c = FIELD_HEIGHT - 1; c < anchor; c += FIELD_HEIGHT) {
+      size = size - equal(block.labels[c], key);
+    }
+    for (std::size_t c = anchor; c < BATCH_CELLS; c++) {
+      size = size - equal(block.labels[c], key);
+    }
+
+    Lanes better = greater(size, best_size);
+    best_size = select(better, size, best_size);
+    best_label = select(better, key, best_label);
+  }
+}
+
+/**
+ * @brief Removes the chosen clusters and lets the balls fall and the columns
+ * move left over the emptied ones.
+ *
+ * A pass over a column moves every ball above its lowest hole down by one,
+ * and a pass over the field every column after the first empty one left by
+ * one; the passes repeat while any game has a hole left.
+ */
+static void make_moves(BatchBlock &block, Lanes best_label) {
+  Lanes empty = broadcast(0);
+  Lanes has_move = ~equal(best_label, broadcast(no_label));
+
+  for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+    Lanes *balls = block.balls + column * FIELD_HEIGHT;
+    const Lanes *labels = block.labels + column * FIELD_HEIGHT;
+    Lanes touched = broadcast(0);
+    for (std::size_t row = 0; row < FIELD_HEIGHT; row++) {
+      Lanes removed = equal(labels[row], best_label) & has_move;
+      balls[row] = select(removed, empty, balls[row]);
+      touched = touched | removed;
+    }
+
+    while (any(touched)) {
+      touched = broadcast(0);
+      for (std::size_t row = 0; row + 1 < FIELD_HEIGHT; row++) {
+        Lanes hole = equal(balls[row], empty);
+        touched = touched | (hole & ~equal(balls[row + 1], empty));
+        balls[row] = select(hole, balls[row + 1], balls[row]);
+        balls[row + 1] = select(hole, empty, balls[row + 1]);
+      }
+    }
+  }
+
+  while (true) {
+    Lanes gaps = broadcast(0);
+    for (std::size_t column = 0; column + 1 < FIELD_WIDTH; column++) {
+      gaps = gaps | (equal(block.balls[column * FIELD_HEIGHT], empty) &
+                     ~equal(block.balls[(column + 1) * FIELD_HEIGHT], empty));
+    }
+    if (!any(gaps)) {
+      break;
+    }
+    for (std::size_t column = 0; column + 1 < FIELD_WIDTH; column++) {
+      Lanes *left = block.balls + column * FIELD_HEIGHT;
+      Lanes *right = left + FIELD_HEIGHT;
+      Lanes gap = equal(left[0], empty);
+      for (std::size_t row = 0; row < FIELD_HEIGHT; row++) {
+        left[row] = select(gap, right[row], left[row]);
+        right[row] = select(gap, empty, right[row]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Adds a field to the batch.
+ *
+ * @param field The game field data, the top row first.
+ * @throws std::invalid_argument If any element in the field is not a valid
+ *         character.
+ */
+void BatchGame::add_field(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]) {
+  std::array<char, BATCH_CELLS> cells;
+  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
+    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
+      char colour;
+      switch (field[i][j]) {
+        case 'R':
+          colour = 1;
+          break;
+        case 'G':
+          colour = 2;
+          break;
+        case 'B':
+          colour = 3;
+          break;
+        default:
+          throw std::invalid_argument("Invalid char in field");
+      }
+      cells[j * FIELD_HEIGHT + FIELD_HEIGHT - 1 - i] = colour;
+    }
+  }
+  fields_.push_back(cells);
+}
+
+std::size_t BatchGame::size() const { return fields_.size(); }
+
+/**
+ * @brief Plays the greedy game on every field of the batch.
+ *
+ * @return The results of the games, in the order of the fields.
+ */
+std::vector<BatchResult> BatchGame::play() const {
+  std::vector<BatchResult> results;
+  results.reserve(fields_.size());
+
+  BatchBlock block;
+  for (std::size_t first = 0; first < fields_.size(); first += BATCH_LANES) {
+    // The lanes after the last field hold empty fields, which have no move
+    std::size_t count = std::min<std::size_t>(BATCH_LANES,
+                                              fields_.size() - first);
+    std::uint8_t bytes[BATCH_LANES];
+    for (std::size_t c = 0; c < BATCH_CELLS; c++) {
+      for (std::size_t g = 0; g < BATCH_LANES; g++) {
+        bytes[g] = g < count ? fields_[first + g][c] : 0;
+      }
+      std::memcpy(&block.balls[c], bytes, BATCH_LANES);
+    }
+
+    std::size_t scores[BATCH_LANES] = {};
+    while (true) {
+      label_clusters(block);
+      Lanes best_label, best_size;
+      choose_moves(block, best_label, best_size);
+      if (!any(~equal(best_label, broadcast(no_label)))) {
+        break;
+      }
+
+      std::uint8_t labels[BATCH_LANES], sizes[BATCH_LANES];
+      std::memcpy(labels, &best_label, BATCH_LANES);
+      std::memcpy(sizes, &best_size, BATCH_LANES);
+      for (std::size_t g = 0; g < BATCH_LANES; g++) {
+        if (labels[g] != no_label) {
+          scores[g] += (sizes[g] - 2) * (sizes[g] - 2);
+        }
+      }
+      make_moves(block, best_label);
+    }
+
+    std::size_t balls[BATCH_LANES] = {};
+    for (std::size_t c = 0; c < BATCH_CELLS; c++) {
+      std::memcpy(bytes, &block.balls[c], BATCH_LANES);
+      for (std::size_t g = 0; g < BATCH_LANES; g++) {
+        balls[g] += bytes[g] != 0;
+      }
+    }
+    for (std::size_t g = 0; g < count; g++) {
+      std::size_t score = balls[g] ? scores[g] : scores[g] + CLEAR_BONUS;
+      results.push_back({score, balls[g]});
+    }
+  }
+  return results;
+}
+
+/**
+ * @brief Plays greedy games on random fields and reports their throughput.
+ *
+ * The fields are drawn and played in batches, so the memory stays small for
+ * any number of games; only the playing is timed.
+ *
+ * @param games The number of games to play.
+ * @param seed The seed of the random fields.
+ * @return The report of the simulation.
+ */
+std::string handle_batch_simulation(std::size_t games, std::uint64_t seed) {
+  const char colours[] = {'R', 'G', 'B'};
+  const std::size_t batch_size = 64 * BATCH_LANES;
+  std::mt19937_64 generator(seed);
+  std::uniform_int_distribution<std::size_t> colour(0, 2);
+
+  std::size_t total_score = 0, cleared = 0;
+  std::chrono::steady_clock::duration elapsed{};
+  for (std::size_t played = 0; played < games; played += batch_size) {
+    BatchGame batch;
+    for (std::size_t k = 0; k < batch_size && played + k < games; k++) {
+      char field[FIELD_HEIGHT][FIELD_WIDTH];
+      for (auto &row : field) {
+        for (auto &cell : row) {
+          cell = colours[colour(generator)];
+        }
+      }
+      batch.add_field(field);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = batch.play();
+    elapsed += std::chrono::steady_clock::now() - start;
+
+    for (const auto &result : results) {
+      total_score += result.score;
+      cleared += result.balls_remaining == 0;
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  std::stringstream report;
+  report << "Simulated " << games << " games in " << seconds << " s ("
+         << (seconds > 0 ? games / seconds : 0) << " games/s)\n"
+         << "Average score "
+         << (games ? static_cast<double>(total_score) / games : 0) << ", "
+         << cleared << " fields cleared\n";
+  return report.str();
+}
+
+}  // namespace RGB_Game
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RGBGame.hpp"
+
+// Games played side by side, one per byte lane of a vector
+#define BATCH_LANES 16
+
+namespace RGB_Game {
+
+/**
+ * @brief How a game of the batch ended.
+ */
+struct BatchResult {
+  std::size_t score;
+  std::size_t balls_remaining;
+};
+
+/**
+ * @brief Plays many greedy games at once, BATCH_LANES of them in lockstep.
+ *
+ * The games of a block are laid out structure-of-arrays: every cell of the
+ * field is a vector with the ball of each game in its own byte lane. The
+ * clusters are labelled, the moves chosen and the balls dropped by the same
+ * vector operations for all games of the block, which end with the same
+ * scores as RGB_Game. A block runs until none of its games has a move left.
+ */
+class BatchGame {
+ private:
+  std::vector<std::array<char, FIELD_HEIGHT * FIELD_WIDTH>> fields_;
+
+ public:
+  void add_field(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]);
+
+  std::size_t size() const;
+
+  std::vector<BatchResult> play() const;
+};
+
+std::string handle_batch_simulation(std::size_t games, std::uint64_t seed);
+
+}  // namespace RGB_Game
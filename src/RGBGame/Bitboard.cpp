@@ -0,0 +1,529 @@
+#include "Bitboard.hpp"
+
+#include <bit>
+#include <stdexcept>
+
+#include "Search.hpp"
+
+namespace RGB_Game {
+
+// The colours of the balls, in the order of the colour masks
+static const char colour_chars[NUMBER_OF_COLOURS] = {'R', 'G', 'B'};
+
+// Bits of the rows of the field in one column
+static const std::uint16_t column_mask = (1u << FIELD_HEIGHT) - 1;
+
+static_assert(FIELD_HEIGHT < BITBOARD_COLUMN_BITS,
+              "A column needs a spare bit above the top row");
+static_assert(FIELD_WIDTH * BITBOARD_COLUMN_BITS <= BITBOARD_WORDS * 64,
+              "The field does not fit in a bitboard");
+
+// Zobrist keys of a ball of every colour in every bit, drawn by splitmix64
+static constexpr auto zobrist_keys = [] {
+  std::array<std::array<std::uint64_t, BITBOARD_WORDS * 64>, NUMBER_OF_COLOURS>
+      keys{};
+  std::uint64_t state = 0;
+  for (auto &colour_keys : keys) {
+    for (auto &key : colour_keys) {
+      std::uint64_t z = (state += 0x9E3779B97F4A7C15);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+      key = z ^ (z >> 31);
+    }
+  }
+  return keys;
+}();
+
+/**
+ * @brief Returns the XOR of the keys of balls of a colour in the cells.
+ */
+static std::uint64_t cells_hash(std::size_t colour, const Bitboard &cells) {
+  std::uint64_t hash = 0;
+  for (std::size_t k = 0; k < BITBOARD_WORDS; k++) {
+    for (std::uint64_t word = cells.word(k); word; word &= word - 1) {
+      hash ^= zobrist_keys[colour][k * 64 + std::countr_zero(word)];
+    }
+  }
+  return hash;
+}
+
+Bitboard Bitboard::cell(std::size_t column, std::size_t row) {
+  Bitboard board;
+  std::size_t bit = column * BITBOARD_COLUMN_BITS + row;
+  board.words_[bit / 64] = std::uint64_t(1) << (bit % 64);
+  return board;
+}
+
+/**
+ * @brief Returns the set of all cells of the field.
+ */
+Bitboard Bitboard::field() {
+  Bitboard board;
+  for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+    board.set_column(column, column_mask);
+  }
+  return board;
+}
+
+/**
+ * @brief Returns the cells of the top row, which choose_move never picks.
+ */
+Bitboard Bitboard::top_row() {
+  Bitboard board;
+  for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+    board.set_column(column, 1u << (FIELD_HEIGHT - 1));
+  }
+  return board;
+}
+
+bool Bitboard::empty() const {
+  for (auto word : words_) {
+    if (word) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t Bitboard::count() const {
+  std::size_t count = 0;
+  for (auto word : words_) {
+    count += std::popcount(word);
+  }
+  return count;
+}
+
+/**
+ * @brief Returns the index of the lowest set bit, which must exist.
+ */
+std::size_t Bitboard::lowest() const {
+  std::size_t k = 0;
+  while (!words_[k]) {
+    k++;
+  }
+  return k * 64 + std::countr_zero(words_[k]);
+}
+
+std::uint64_t Bitboard::word(std::size_t k) const { return words_[k]; }
+
+std::uint16_t Bitboard::column(std::size_t column) const {
+  std::size_t bit = column * BITBOARD_COLUMN_BITS;
+  return static_cast<std::uint16_t>(words_[bit / 64] >> (bit % 64));
+}
+
+void Bitboard::set_column(std::size_t column, std::uint16_t bits) {
+  std::size_t bit = column * BITBOARD_COLUMN_BITS;
+  auto &word = words_[bit / 64];
+  word &= ~(std::uint64_t(0xFFFF) << (bit % 64));
+  word |= std::uint64_t(bits) << (bit % 64);
+}
+
+/**
+ * @brief Returns the cells next to the set, above, below, left or right,
+ * inside the field.
+ *
+ * The neighbours in a column are one bit away and never cross the spare bits
+ * between the columns, so every word is shifted on its own; the neighbours
+ * in a row are a column away and carry across the words.
+ */
+Bitboard Bitboard::neighbours() const {
+  static const Bitboard inside = field();
+
+  Bitboard result;
+  for (std::size_t k = 0; k < BITBOARD_WORDS; k++) {
+    std::uint64_t word = words_[k];
+    std::uint64_t left = word >> BITBOARD_COLUMN_BITS;
+    std::uint64_t right = word << BITBOARD_COLUMN_BITS;
+    if (k + 1 < BITBOARD_WORDS) {
+      left |= words_[k + 1] << (64 - BITBOARD_COLUMN_BITS);
+    }
+    if (k > 0) {
+      right |= words_[k - 1] >> (64 - BITBOARD_COLUMN_BITS);
+    }
+    result.words_[k] =
+        ((word << 1) | (word >> 1) | left | right) & inside.words_[k];
+  }
+  return result;
+}
+
+Bitboard Bitboard::operator&(const Bitboard &other) const {
+  Bitboard result = *this;
+  return result &= other;
+}
+
+Bitboard Bitboard::operator|(const Bitboard &other) const {
+  Bitboard result = *this;
+  return result |= other;
+}
+
+Bitboard Bitboard::operator^(const Bitboard &other) const {
+  Bitboard result = *this;
+  return result ^= other;
+}
+
+/**
+ * @brief Returns the cells of the field which are not in the set.
+ */
+Bitboard Bitboard::operator~() const {
+  static const Bitboard inside = field();
+
+  Bitboard result;
+  for (std::size_t k = 0; k < BITBOARD_WORDS; k++) {
+    result.words_[k] = ~words_[k] & inside.words_[k];
+  }
+  return result;
+}
+
+Bitboard &Bitboard::operator&=(const Bitboard &other) {
+  for (std::size_t k = 0; k < BITBOARD_WORDS; k++) {
+    words_[k] &= other.words_[k];
+  }
+  return *this;
+}
+
+Bitboard &Bitboard::operator|=(const Bitboard &other) {
+  for (std::size_t k = 0; k < BITBOARD_WORDS; k++) {
+    words_[k] |= other.words_[k];
+  }
+  return *this;
+}
+
+Bitboard &Bitboard::operator^=(const Bitboard &other) {
+  for (std::size_t k = 0; k < BITBOARD_WORDS; k++) {
+    words_[k] ^= other.words_[k];
+  }
+  return *this;
+}
+
+bool Bitboard::operator==(const Bitboard &other) const {
+  return words_ == other.words_;
+}
+
+bool Bitboard::operator!=(const Bitboard &other) const {
+  return !(*this == other);
+}
+
+std::size_t BitboardMove::points() const { return (size - 2) * (size - 2); }
+
+/**
+ * @brief Constructs a new BitboardField object.
+ *
+ * @param field The game field data, the top row first.
+ * @throws std::invalid_argument If any element in the field is not a valid
+ *         character.
+ */
+BitboardField::BitboardField(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]) {
+  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
+    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
+      std::size_t colour = 0;
+      while (colour < NUMBER_OF_COLOURS &&
+             colour_chars[colour] != field[i][j]) {
+        colour++;
+      }
+      if (colour == NUMBER_OF_COLOURS) {
+        throw std::invalid_argument("Invalid char in field");
+      }
+      colours_[colour] |= Bitboard::cell(j, FIELD_HEIGHT - 1 - i);
+    }
+  }
+
+  for (std::size_t colour = 0; colour < NUMBER_OF_COLOURS; colour++) {
+    hash_ ^= cells_hash(colour, colours_[colour]);
+  }
+}
+
+/**
+ * @brief Finds the cluster of a colour containing the seed cells.
+ *
+ * The cluster grows by its neighbours of the same colour until it stops
+ * changing, one step of the flood fill per iteration.
+ */
+Bitboard BitboardField::fill_cluster(const Bitboard &seed,
+                                     const Bitboard &colour) const {
+  Bitboard cluster = seed;
+  while (true) {
+    Bitboard grown = (cluster | cluster.neighbours()) & colour;
+    if (grown == cluster) {
+      return cluster;
+    }
+    cluster = grown;
+  }
+}
+
+/**
+ * @brief Calls visit for every move of the field, colour by colour and the
+ * clusters of a colour by their lowest cell.
+ *
+ * The anchor of a move is the first cell of its cluster outside the top row
+ * in the order RGB_Game::choose_move scans the field: by column from the
+ * left, every column from the bottom up; the bitboards list the cells in
+ * that order.
+ */
+template <typename Visit>
+void BitboardField::visit_moves(Visit visit) const {
+  static const Bitboard below_top = ~Bitboard::top_row();
+
+  for (std::size_t colour = 0; colour < NUMBER_OF_COLOURS; colour++) {
+    // Single balls are never removed, so only the balls with a neighbour of
+    // their colour are flood filled
+    Bitboard remaining = colours_[colour] & colours_[colour].neighbours();
+    while (!remaining.empty()) {
+      std::size_t seed = remaining.lowest();
+      Bitboard cluster =
+          fill_cluster(Bitboard::cell(seed / BITBOARD_COLUMN_BITS,
+                                      seed % BITBOARD_COLUMN_BITS),
+                       colours_[colour]);
+      remaining &= ~cluster;
+
+      std::size_t size = cluster.count();
+      Bitboard choosable = cluster & below_top;
+      if (size > 2 && !choosable.empty()) {
+        visit(BitboardMove{cluster, colour, choosable.lowest(), size});
+      }
+    }
+  }
+}
+
+/**
+ * @brief Lists all moves of the field.
+ *
+ * @param moves Receives the moves; its old content is dropped.
+ */
+void BitboardField::list_moves(std::vector<BitboardMove> &moves) const {
+  moves.clear();
+  visit_moves([&](const BitboardMove &move) { moves.push_back(move); });
+}
+
+/**
+ * @brief Chooses the move of RGB_Game::choose_move.
+ *
+ * That scan picks the first cell whose cluster is larger than all clusters
+ * seen before and than 2, so the largest cluster wins and ties go to the one
+ * whose anchor comes first.
+ *
+ * @param move Receives the move, if there is one.
+ * @return False if no cluster can be removed.
+ */
+bool BitboardField::choose_move(BitboardMove &move) const {
+  bool found = false;
+  visit_moves([&](const BitboardMove &candidate) {
+    if (!found || candidate.size > move.size ||
+        (candidate.size == move.size && candidate.anchor < move.anchor)) {
+      found = true;
+      move = candidate;
+    }
+  });
+  return found;
+}
+
+/**
+ * @brief Removes the cluster of a move and lets the balls fall.
+ */
+void BitboardField::make_move(const BitboardMove &move) {
+  MoveUndo undo;
+  apply_move(move, undo);
+}
+
+/**
+ * @brief Makes a move and records what it changed.
+ *
+ * The hash changes by the keys of the cells a ball left or entered.
+ *
+ * @param undo Receives the record undo_move takes the move back by.
+ */
+void BitboardField::apply_move(const BitboardMove &move, MoveUndo &undo) {
+  undo.cluster = move.cluster;
+  undo.colour = move.colour;
+  undo.hash = hash_;
+
+  std::array<Bitboard, NUMBER_OF_COLOURS> before = colours_;
+  colours_[move.colour] &= ~move.cluster;
+  undo.emptied_columns = update_field(move.cluster);
+
+  for (std::size_t colour = 0; colour < NUMBER_OF_COLOURS; colour++) {
+    hash_ ^= cells_hash(colour, before[colour] ^ colours_[colour]);
+  }
+}
+
+/**
+ * @brief Takes back the last move applied to the field.
+ *
+ * The emptied columns are put back in their places, then every column the
+ * move touched opens its holes again from the bottom up, so the balls above
+ * a hole rise by one, and the cluster fills the holes.
+ */
+void BitboardField::undo_move(const MoveUndo &undo) {
+  if (undo.emptied_columns) {
+    for (auto &colour : colours_) {
+      Bitboard unpacked;
+      std::size_t source = 0;
+      for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+        if (!((undo.emptied_columns >> column) & 1)) {
+          unpacked.set_column(column, colour.column(source++));
+        }
+      }
+      colour = unpacked;
+    }
+  }
+
+  for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+    std::uint16_t holes = undo.cluster.column(column);
+    if (!holes) {
+      continue;
+    }
+    for (auto &colour : colours_) {
+      std::uint16_t bits = colour.column(column);
+      for (std::uint16_t rest = holes; rest; rest &= rest - 1) {
+        std::uint16_t hole = rest & -rest;
+        std::uint16_t below = hole - 1;
+        bits = (bits & below) | ((bits << 1) & ~(below | hole));
+      }
+      colour.set_column(column, bits);
+    }
+  }
+
+  colours_[undo.colour] |= undo.cluster;
+  hash_ = undo.hash;
+}
+
+/**
+ * @brief Lets the balls fall in the columns a removal touched and packs the
+ * columns left over the emptied ones.
+ *
+ * @param removed The removed cells.
+ * @return The columns the removal emptied, bit c for column c.
+ */
+std::uint16_t BitboardField::update_field(const Bitboard &removed) {
+  std::uint16_t emptied_columns = 0;
+  for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+    std::uint16_t holes = removed.column(column);
+    if (!holes) {
+      continue;
+    }
+
+    // Close the holes from the top down, so the lower ones stay in place
+    std::array<std::uint16_t, NUMBER_OF_COLOURS> bits;
+    for (std::size_t colour = 0; colour < NUMBER_OF_COLOURS; colour++) {
+      bits[colour] = colours_[colour].column(column);
+    }
+    while (holes) {
+      std::uint16_t below = std::bit_floor(holes) - 1;
+      holes &= below;
+      for (auto &column_bits : bits) {
+        column_bits = (column_bits & below) | ((column_bits >> 1) & ~below);
+      }
+    }
+
+    std::uint16_t occupied = 0;
+    for (std::size_t colour = 0; colour < NUMBER_OF_COLOURS; colour++) {
+      colours_[colour].set_column(column, bits[colour]);
+      occupied |= bits[colour];
+    }
+    if (!occupied) {
+      emptied_columns |= 1u << column;
+    }
+  }
+  if (!emptied_columns) {
+    return 0;
+  }
+
+  // Keep the columns with balls, in order
+  Bitboard occupied;
+  for (const auto &colour : colours_) {
+    occupied |= colour;
+  }
+  for (auto &colour : colours_) {
+    Bitboard packed;
+    std::size_t target = 0;
+    for (std::size_t column = 0; column < FIELD_WIDTH; column++) {
+      if (occupied.column(column)) {
+        packed.set_column(target++, colour.column(column));
+      }
+    }
+    colour = packed;
+  }
+  return emptied_columns;
+}
+
+std::size_t BitboardField::count_balls_on_field() const {
+  std::size_t count = 0;
+  for (const auto &colour : colours_) {
+    count += colour.count();
+  }
+  return count;
+}
+
+/**
+ * @brief Returns the number of balls of a colour.
+ */
+std::size_t BitboardField::count_balls(std::size_t colour) const {
+  return colours_[colour].count();
+}
+
+/**
+ * @brief Returns the Zobrist hash of the balls, equal for equal fields.
+ */
+std::uint64_t BitboardField::hash() const { return hash_; }
+
+bool BitboardField::operator==(const BitboardField &other) const {
+  return colours_ == other.colours_;
+}
+
+bool BitboardField::operator!=(const BitboardField &other) const {
+  return !(*this == other);
+}
+
+/**
+ * @brief Constructs a new BitboardGame object.
+ *
+ * @param field The game field data, the top row first.
+ * @throws std::invalid_argument If any element in the field is not a valid
+ *         character.
+ */
+BitboardGame::BitboardGame(char (&field)[FIELD_HEIGHT][FIELD_WIDTH])
+    : field_(field) {}
+
+/**
+ * @brief Makes a move, scores it and records it as RGB_Game::make_move does.
+ */
+void BitboardGame::make_move(const BitboardMove &move) {
+  field_.make_move(move);
+
+  std::size_t acquired_points = move.points();
+  total_score += acquired_points;
+
+  // The row of the anchor counts from the bottom, as the rows of the task
+  std::size_t column = move.anchor / BITBOARD_COLUMN_BITS;
+  std::size_t row = move.anchor % BITBOARD_COLUMN_BITS;
+  game_record.add_move({static_cast<std::uint8_t>(row + 1),
+                        static_cast<std::uint8_t>(column + 1),
+                        colour_chars[move.colour],
+                        static_cast<std::uint16_t>(move.size),
+                        static_cast<std::uint32_t>(acquired_points)});
+}
+
+/**
+ * @brief Plays the game by the rules of RGB_Game::play.
+ */
+void BitboardGame::play() { play(SearchConfig()); }
+
+/**
+ * @brief Plays the moves planned by the search of the config, then records
+ * the final score as RGB_Game::play does.
+ */
+void BitboardGame::play(const SearchConfig &config) {
+  for (const auto &move : plan_moves(field_, config)) {
+    make_move(move);
+  }
+
+  std::size_t n_balls = field_.count_balls_on_field();
+  total_score = (n_balls == 0) ? total_score + 1000 : total_score;
+
+  game_record.finish(total_score, n_balls);
+}
+
+const GameRecord &BitboardGame::get_record() const { return game_record; }
+
+std::string BitboardGame::dumps_log() { return game_record.dumps_log(); }
+
+}  // namespace RGB_Game
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "RGBGame.hpp"
+
+// Bits reserved for one column of the field, and 64-bit words of a bitboard
+#define BITBOARD_COLUMN_BITS 16
+#define BITBOARD_WORDS 4
+
+// Number of ball colours
+#define NUMBER_OF_COLOURS 3
+
+namespace RGB_Game {
+
+/**
+ * @brief Set of cells of the field packed column by column.
+ *
+ * Column c takes the bits [16 * c, 16 * c + FIELD_HEIGHT), with the bottom
+ * row in the lowest bit, so the balls of a column fall towards bit 0 and the
+ * cells come in the order choose_move scans them: by column from the left,
+ * every column from the bottom up. The unused bits of every column stay 0,
+ * so shifting by one bit moves a set along its columns without spilling
+ * into the neighbouring ones.
+ */
+class Bitboard {
+ private:
+  std::array<std::uint64_t, BITBOARD_WORDS> words_{};
+
+ public:
+  Bitboard() = default;
+
+  static Bitboard cell(std::size_t column, std::size_t row);
+  static Bitboard field();
+  static Bitboard top_row();
+
+  bool empty() const;
+  std::size_t count() const;
+  std::size_t lowest() const;
+
+  std::uint64_t word(std::size_t k) const;
+  std::uint16_t column(std::size_t column) const;
+  void set_column(std::size_t column, std::uint16_t bits);
+
+  Bitboard neighbours() const;
+
+  Bitboard operator&(const Bitboard &other) const;
+  Bitboard operator|(const Bitboard &other) const;
+  Bitboard operator^(const Bitboard &other) const;
+  Bitboard operator~() const;
+  Bitboard &operator&=(const Bitboard &other);
+  Bitboard &operator|=(const Bitboard &other);
+  Bitboard &operator^=(const Bitboard &other);
+
+  bool operator==(const Bitboard &other) const;
+  bool operator!=(const Bitboard &other) const;
+};
+
+/**
+ * @brief A cluster chosen to be removed.
+ */
+struct BitboardMove {
+  Bitboard cluster;
+  std::size_t colour;
+  std::size_t anchor;  // bit of the cell the move is made at
+  std::size_t size;
+
+  std::size_t points() const;
+};
+
+/**
+ * @brief What a move changed on a field, enough to take the move back.
+ */
+struct MoveUndo {
+  Bitboard cluster;  // removed cells, before the balls fell
+  std::size_t colour;
+  std::uint16_t emptied_columns;  // bit c for column c, before packing
+  std::uint64_t hash;             // hash of the field before the move
+};
+
+/**
+ * @brief The balls of the field, one bitboard per colour.
+ *
+ * A move may remove any cluster of more than 2 balls with a ball below the
+ * top row, the clusters RGB_Game can choose from. The field keeps its
+ * Zobrist hash, the XOR of a random key for every ball by its colour and
+ * cell, up to date with the balls a move removes and moves.
+ *
+ * The field is trivially copyable and owns no memory, so a search can copy
+ * it for every position, or walk a single field down and up its moves with
+ * apply_move and undo_move.
+ */
+class BitboardField {
+ private:
+  std::array<Bitboard, NUMBER_OF_COLOURS> colours_;
+  std::uint64_t hash_ = 0;
+
+  Bitboard fill_cluster(const Bitboard &seed, const Bitboard &colour) const;
+  std::uint16_t update_field(const Bitboard &removed);
+
+  template <typename Visit>
+  void visit_moves(Visit visit) const;
+
+ public:
+  BitboardField(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]);
+
+  void list_moves(std::vector<BitboardMove> &moves) const;
+  bool choose_move(BitboardMove &move) const;
+  void make_move(const BitboardMove &move);
+  void apply_move(const BitboardMove &move, MoveUndo &undo);
+  void undo_move(const MoveUndo &undo);
+
+  std::size_t count_balls_on_field() const;
+  std::size_t count_balls(std::size_t colour) const;
+  std::uint64_t hash() const;
+
+  bool operator==(const BitboardField &other) const;
+  bool operator!=(const BitboardField &other) const;
+};
+
+static_assert(std::is_trivially_copyable_v<BitboardField>,
+              "A field must copy as plain memory");
+
+struct SearchConfig;
+
+/**
+ * @brief The RGB game played on one bitboard per colour.
+ *
+ * Plays by the rules of RGB_Game and writes the same log, but finds the
+ * clusters by flood filling the colour masks with shifts, removes a cluster
+ * with a bitwise AND and lets only the columns it touched fall, instead of
+ * rebuilding a DSU over the whole field after every move.
+ */
+class BitboardGame {
+ private:
+  BitboardField field_;
+  std::size_t total_score = 0;
+  GameRecord game_record;
+
+  void make_move(const BitboardMove &move);
+
+ public:
+  BitboardGame(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]);
+
+  void play();
+  void play(const SearchConfig &config);
+
+  const GameRecord &get_record() const;
+
+  std::string dumps_log();
+};
+
+}  // namespace RGB_Game
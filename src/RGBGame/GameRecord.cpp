@@ -0,0 +1,163 @@
+#include "GameRecord.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace RGB_Game {
+
+// First bytes of a replay, naming the format and its version
+static const char replay_magic[] = {'R', 'G', 'B', '1'};
+
+// Bytes of a move in a replay: row, column, colour and removed balls
+static const std::size_t replay_move_bytes = 5;
+
+/**
+ * @brief Appends the lowest bytes of a value, the lowest first.
+ */
+static void put_bytes(std::string &out, std::uint64_t value,
+                      std::size_t bytes) {
+  for (std::size_t k = 0; k < bytes; k++) {
+    out.push_back(static_cast<char>(value >> (8 * k) & 0xFF));
+  }
+}
+
+/**
+ * @brief Reads a value written by put_bytes and moves past it.
+ *
+ * @throws std::invalid_argument If the replay ends first.
+ */
+static std::uint64_t get_bytes(const std::string &in, std::size_t &offset,
+                               std::size_t bytes) {
+  if (in.size() - offset < bytes) {
+    throw std::invalid_argument("Truncated replay");
+  }
+  std::uint64_t value = 0;
+  for (std::size_t k = 0; k < bytes; k++) {
+    std::uint64_t byte = static_cast<unsigned char>(in[offset++]);
+    value |= byte << (8 * k);
+  }
+  return value;
+}
+
+bool MoveRecord::operator==(const MoveRecord &other) const {
+  return row == other.row && column == other.column &&
+         colour == other.colour && removed == other.removed &&
+         points == other.points;
+}
+
+bool MoveRecord::operator!=(const MoveRecord &other) const {
+  return !(*this == other);
+}
+
+void GameRecord::add_move(const MoveRecord &move) { moves_.push_back(move); }
+
+/**
+ * @brief Records the outcome of the game, after its last move.
+ */
+void GameRecord::finish(std::size_t final_score,
+                        std::size_t balls_remaining) {
+  final_score_ = final_score;
+  balls_remaining_ = balls_remaining;
+}
+
+const std::vector<MoveRecord> &GameRecord::moves() const { return moves_; }
+
+std::size_t GameRecord::final_score() const { return final_score_; }
+
+std::size_t GameRecord::balls_remaining() const { return balls_remaining_; }
+
+/**
+ * @brief Formats the log of the game, a line per move and one for the final
+ * score.
+ */
+std::string GameRecord::dumps_log() const {
+  std::stringstream log;
+  std::size_t move_count = 1;
+  for (const auto &move : moves_) {
+    log << "Move " << move_count++ << " at (" << +move.row << ", "
+        << +move.column << ")" << ": removed " << move.removed
+        << " balls of color " << move.colour << ", got " << move.points
+        << " points\n";
+  }
+  log << "Final score " << final_score_ << " with " << balls_remaining_
+      << " balls remaining\n";
+  return log.str();
+}
+
+/**
+ * @brief Packs the record into a binary replay.
+ *
+ * The replay holds the magic "RGB1", the number of moves in 4 bytes, 5 bytes
+ * per move (row, column, colour, and the removed balls in 2 bytes), the
+ * final score in 4 bytes and the balls remaining in 2 bytes; numbers are
+ * little-endian. The points of a move follow from the removed balls, so
+ * they are not stored.
+ */
+std::string GameRecord::dumps_replay() const {
+  std::string replay(replay_magic, sizeof(replay_magic));
+  replay.reserve(sizeof(replay_magic) + 4 +
+                 moves_.size() * replay_move_bytes + 6);
+  put_bytes(replay, moves_.size(), 4);
+  for (const auto &move : moves_) {
+    put_bytes(replay, move.row, 1);
+    put_bytes(replay, move.column, 1);
+    put_bytes(replay, static_cast<unsigned char>(move.colour), 1);
+    put_bytes(replay, move.removed, 2);
+  }
+  put_bytes(replay, final_score_, 4);
+  put_bytes(replay, balls_remaining_, 2);
+  return replay;
+}
+
+/**
+ * @brief Unpacks a binary replay written by dumps_replay.
+ *
+ * @param replay The bytes of the replay.
+ * @return The record of the game.
+ * @throws std::invalid_argument If the replay is not in the format, or holds
+ *         a move no game can make.
+ */
+GameRecord GameRecord::loads_replay(const std::string &replay) {
+  if (replay.compare(0, sizeof(replay_magic), replay_magic,
+                     sizeof(replay_magic)) != 0) {
+    throw std::invalid_argument("Not a replay");
+  }
+  std::size_t offset = sizeof(replay_magic);
+
+  GameRecord record;
+  std::size_t n_moves = get_bytes(replay, offset, 4);
+  if ((replay.size() - offset) / replay_move_bytes < n_moves) {
+    throw std::invalid_argument("Truncated replay");
+  }
+  record.moves_.reserve(n_moves);
+  for (std::size_t k = 0; k < n_moves; k++) {
+    MoveRecord move;
+    move.row = static_cast<std::uint8_t>(get_bytes(replay, offset, 1));
+    move.column = static_cast<std::uint8_t>(get_bytes(replay, offset, 1));
+    move.colour = static_cast<char>(get_bytes(replay, offset, 1));
+    move.removed = static_cast<std::uint16_t>(get_bytes(replay, offset, 2));
+    if (move.row == 0 || move.column == 0 || move.removed < 3 ||
+        (move.colour != 'R' && move.colour != 'G' && move.colour != 'B')) {
+      throw std::invalid_argument("Invalid move in replay");
+    }
+    move.points = (move.removed - 2u) * (move.removed - 2u);
+    record.moves_.push_back(move);
+  }
+  record.final_score_ = get_bytes(replay, offset, 4);
+  record.balls_remaining_ = get_bytes(replay, offset, 2);
+  if (offset != replay.size()) {
+    throw std::invalid_argument("Trailing bytes in replay");
+  }
+  return record;
+}
+
+bool GameRecord::operator==(const GameRecord &other) const {
+  return moves_ == other.moves_ && final_score_ == other.final_score_ &&
+         balls_remaining_ == other.balls_remaining_;
+}
+
+bool GameRecord::operator!=(const GameRecord &other) const {
+  return !(*this == other);
+}
+
+}  // namespace RGB_Game
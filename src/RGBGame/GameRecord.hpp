@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace RGB_Game {
+
+/**
+ * @brief A move as the log reports it.
+ *
+ * The row counts from the bottom and the column from the left, both from 1.
+ */
+struct MoveRecord {
+  std::uint8_t row;
+  std::uint8_t column;
+  char colour;
+  std::uint16_t removed;  // balls of the cluster
+  std::uint32_t points;
+
+  bool operator==(const MoveRecord &other) const;
+  bool operator!=(const MoveRecord &other) const;
+};
+
+/**
+ * @brief The moves and the outcome of a game, kept as structs while it is
+ * played.
+ *
+ * The text of the log is formatted only when it is asked for, so a game
+ * whose caller wants the score alone pays for no formatting. The binary
+ * replay stores the same record in a few bytes per move.
+ */
+class GameRecord {
+ private:
+  std::vector<MoveRecord> moves_;
+  std::size_t final_score_ = 0;
+  std::size_t balls_remaining_ = 0;
+
+ public:
+  void add_move(const MoveRecord &move);
+  void finish(std::size_t final_score, std::size_t balls_remaining);
+
+  const std::vector<MoveRecord> &moves() const;
+  std::size_t final_score() const;
+  std::size_t balls_remaining() const;
+
+  std::string dumps_log() const;
+
+  std::string dumps_replay() const;
+  static GameRecord loads_replay(const std::string &replay);
+
+  bool operator==(const GameRecord &other) const;
+  bool operator!=(const GameRecord &other) const;
+};
+
+}  // namespace RGB_Game
@@ -0,0 +1,117 @@
+#include "GameSession.hpp"
+
+#include <stdexcept>
+
+namespace RGB_Game {
+
+/**
+ * @brief Starts a session on a field.
+ *
+ * @param rows The rows of the field, the top row first.
+ * @throws std::invalid_argument If the field has an invalid size or an
+ *         invalid character.
+ */
+template <std::size_t Height, std::size_t Width>
+BasicGameSession<Height, Width>::BasicGameSession(
+    const std::vector<std::string> &rows)
+    : game_(std::make_unique<BasicRGBGame<Height, Width>>(rows)) {
+  find_best_move();
+}
+
+/**
+ * @brief Finds the move play() would make next, or finishes the game if
+ * there is none.
+ */
+template <std::size_t Height, std::size_t Width>
+void BasicGameSession<Height, Width>::find_best_move() {
+  Point point = game_->choose_move();
+  if (point == Point(-1, 0)) {
+    std::size_t n_balls = game_->count_balls_on_field();
+    game_->total_score =
+        (n_balls == 0) ? game_->total_score + 1000 : game_->total_score;
+    game_->game_record.finish(game_->total_score, n_balls);
+    finished_ = true;
+    return;
+  }
+
+  std::size_t removed = game_->get_cluster_size(point);
+  best_move_ = {static_cast<std::uint8_t>(game_->height() - point.y()),
+                static_cast<std::uint8_t>(point.x() + 1),
+                game_->game_field[point.y()][point.x()],
+                static_cast<std::uint16_t>(removed),
+                static_cast<std::uint32_t>((removed - 2) * (removed - 2))};
+}
+
+/**
+ * @brief Recommends the move of the greedy rule.
+ *
+ * @param move Receives the move, if there is one.
+ * @return False if no move is left.
+ */
+template <std::size_t Height, std::size_t Width>
+bool BasicGameSession<Height, Width>::best_move(MoveRecord &move) {
+  if (finished_) {
+    return false;
+  }
+  move = best_move_;
+  return true;
+}
+
+/**
+ * @brief Makes a move chosen by the client.
+ *
+ * @param row The row of a ball of the cluster to remove, from the bottom.
+ * @param column The column of the ball, from the left.
+ * @throws std::invalid_argument If the cell is outside the field, or its
+ *         cluster may not be removed.
+ */
+template <std::size_t Height, std::size_t Width>
+void BasicGameSession<Height, Width>::apply_move(std::size_t row,
+                                                 std::size_t column) {
+  if (row == 0 || column == 0 || row > game_->height() ||
+      column > game_->width()) {
+    throw std::invalid_argument("Move outside the field");
+  }
+  Point point(column - 1, game_->height() - row);
+  if (!game_->is_move(point)) {
+    throw std::invalid_argument("Illegal move");
+  }
+
+  game_->make_move(point);
+  game_->update();
+  find_best_move();
+}
+
+template <std::size_t Height, std::size_t Width>
+bool BasicGameSession<Height, Width>::finished() const {
+  return finished_;
+}
+
+/**
+ * @brief Returns the points of the moves so far, and the bonus once the
+ * field is cleared.
+ */
+template <std::size_t Height, std::size_t Width>
+std::size_t BasicGameSession<Height, Width>::score() const {
+  return game_->total_score;
+}
+
+template <std::size_t Height, std::size_t Width>
+std::size_t BasicGameSession<Height, Width>::balls_remaining() {
+  return game_->count_balls_on_field();
+}
+
+template <std::size_t Height, std::size_t Width>
+const GameRecord &BasicGameSession<Height, Width>::get_record() const {
+  return game_->game_record;
+}
+
+template <std::size_t Height, std::size_t Width>
+std::string BasicGameSession<Height, Width>::dumps_log() {
+  return game_->dumps_log();
+}
+
+template class BasicGameSession<FIELD_HEIGHT, FIELD_WIDTH>;
+template class BasicGameSession<DYNAMIC_SIZE, DYNAMIC_SIZE>;
+
+}  // namespace RGB_Game
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GameRecord.hpp"
+#include "RGBGame.hpp"
+
+namespace RGB_Game {
+
+/**
+ * @brief A game kept alive between the moves of an interactive client.
+ *
+ * The session holds the field and its cluster labels across calls. A move
+ * made by the client updates them in place, as a move of play() does, and
+ * the best move is found by a single scan of the kept labels right after.
+ * A best-move query only reads that move back. Rows count from the bottom
+ * and columns from the left, both from 1, as in the log.
+ *
+ * The session records every move; once no move is left it records the
+ * final score, with the bonus for a cleared field, as play() does.
+ */
+template <std::size_t Height, std::size_t Width>
+class BasicGameSession {
+ private:
+  // The field of the largest size is too big for the stack
+  std::unique_ptr<BasicRGBGame<Height, Width>> game_;
+  MoveRecord best_move_;
+  bool finished_ = false;  // no move is left
+
+  void find_best_move();
+
+ public:
+  explicit BasicGameSession(const std::vector<std::string> &rows);
+
+  bool best_move(MoveRecord &move);
+  void apply_move(std::size_t row, std::size_t column);
+
+  bool finished() const;
+  std::size_t score() const;
+  std::size_t balls_remaining();
+
+  const GameRecord &get_record() const;
+  std::string dumps_log();
+};
+
+// Sessions on the default field, and on a field of any size
+using GameSession = BasicGameSession<FIELD_HEIGHT, FIELD_WIDTH>;
+using DynamicGameSession = BasicGameSession<DYNAMIC_SIZE, DYNAMIC_SIZE>;
+
+}  // namespace RGB_Game
@@ -1,10 +1,20 @@
 #include "RGBGame.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <memory>
 #include <sstream>
 #include <unordered_set>
 #include <vector>
 
+#include "Bitboard.hpp"
+#include "Search.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RGB_GAME_SSSE3
+#include <immintrin.h>
+#endif
+
 namespace RGB_Game {
 
 std::unordered_map<char, bool> chars_allowed{
@@ -34,6 +44,45 @@ std::ostream &operator<<(std::ostream &os, const Point &wall) {
  * @return The result of the RGB game as a string.
  */
 std::string handle_rgb_game(std::istream &input) {
+  return handle_rgb_game(input, SearchConfig());
+}
+
+/**
+ * @brief Handle the RGB game, choosing the moves by the search of the config.
+ *
+ * @param input The input stream to read from.
+ * @param config The move search to use.
+ * @return The result of the RGB game as a string.
+ */
+std::string handle_rgb_game(std::istream &input, const SearchConfig &config) {
+  return handle_rgb_game(input, FIELD_HEIGHT, FIELD_WIDTH, config);
+}
+
+/**
+ * @brief Handle the RGB game on fields of the given size.
+ *
+ * The greedy games on the default field are played by RGB_Game, and on the
+ * other fields by DynamicRGBGame. The other strategies, and the greedy
+ * games with an endgame solver, are played by BitboardGame, which only takes
+ * the default field.
+ *
+ * @param input The input stream to read from.
+ * @param height The number of rows of every field.
+ * @param width The number of columns of every field.
+ * @param config The move search to use.
+ * @return The result of the RGB game as a string.
+ * @throws std::invalid_argument If the field size is out of range.
+ */
+std::string handle_rgb_game(std::istream &input, std::size_t height,
+                            std::size_t width, const SearchConfig &config) {
+  if (height == 0 || width == 0 || height > MAX_FIELD_HEIGHT ||
+      width > MAX_FIELD_WIDTH) {
+    throw std::invalid_argument("Invalid field size");
+  }
+  bool default_size = height == FIELD_HEIGHT && width == FIELD_WIDTH;
+  bool greedy = config.strategy == SearchStrategy::Greedy &&
+                config.endgame_threshold == 0;
+
   // Create a string stream to store the result
   std::stringstream result;
 
@@ -48,20 +97,37 @@ std::string handle_rgb_game(std::istream &input) {
     result << "Game " << counter++ << ":" << std::endl;
 
     // Read the game field from the input stream
-    char field[FIELD_HEIGHT][FIELD_WIDTH];
-    for (std::size_t j = 0; j < FIELD_HEIGHT; j++) {
-      for (std::size_t k = 0; k < FIELD_WIDTH; k++) {
-        input >> field[j][k];
+    std::vector<std::string> rows(height, std::string(width, 0));
+    for (auto &row : rows) {
+      for (auto &ball : row) {
+        input >> ball;
       }
     }
 
     try {
-      // Create a RGB_Game object and play it
-      RGB_Game game(field);
-      game.play();
-
-      // Append the log of the game to the result
-      result << game.dumps_log() << std::endl;
+      if (greedy && default_size) {
+        // Create a RGB_Game object and play it
+        RGB_Game game(rows);
+        game.play();
+
+        // Append the log of the game to the result
+        result << game.dumps_log() << std::endl;
+      } else if (greedy) {
+        // The field of the largest size is too big for the stack
+        auto game = std::make_unique<DynamicRGBGame>(rows);
+        game->play();
+        result << game->dumps_log() << std::endl;
+      } else if (default_size) {
+        char field[FIELD_HEIGHT][FIELD_WIDTH];
+        for (std::size_t j = 0; j < FIELD_HEIGHT; j++) {
+          rows[j].copy(field[j], FIELD_WIDTH);
+        }
+        BitboardGame game(field);
+        game.play(config);
+        result << game.dumps_log() << std::endl;
+      } else {
+        throw std::invalid_argument("Search needs a field of the default size");
+      }
     } catch (const std::invalid_argument &e) {
       result << "Invalid input: " << e.what() << std::endl;
     }
@@ -111,30 +177,66 @@ std::size_t PointHash::operator()(const Point &point) const {
   return hash_x ^ hash_y;
 }
 
+/**
+ * @brief Chooses the first of the largest clusters, the move of
+ * BasicRGBGame::choose_move.
+ */
+std::size_t GreedyStrategy::choose(const std::vector<ClusterMove> &moves) {
+  std::size_t best = 0;
+  for (std::size_t k = 1; k < moves.size(); k++) {
+    if (moves[k].size > moves[best].size) {
+      best = k;
+    }
+  }
+  return best;
+}
+
 /**
  * @brief Initializes the Disjoint Set Union (DSU) data structure.
  *
- * This function initializes the parent, rank, and root_to_cluster_size
- * arrays for the DSU data structure. It assigns each element its own parent
+ * This function initializes the parent, rank, and cluster_size arrays for
+ * the DSU data structure. It assigns each element its own parent
  * and rank, and sets the cluster size to 1.
  *
  * @throws None
  */
-void DSU::init() {
+template <std::size_t Size>
+void DSU<Size>::init() {
   // Iterate over each element in the field
-  for (std::size_t i = 0; i < FIELD_HEIGHT * FIELD_WIDTH; i++) {
+  for (std::size_t i = 0; i < Size; i++) {
     // Set the parent of each element to itself
     parent[i] = i;
     // Set the rank of each element to 1
     rank[i] = 1;
     // Set the cluster size of each element to 1
-    root_to_cluster_size[i] = 1;
+    cluster_size[i] = 1;
   }
 }
 
-void DSU::reset() { init(); }
+template <std::size_t Size>
+void DSU<Size>::reset() {
+  init();
+}
+
+/**
+ * @brief Makes the element at index i a set of its own.
+ *
+ * No other element may point to it afterwards, so the elements of a set are
+ * reset all together.
+ *
+ * @param i The index of the element to reset.
+ */
+template <std::size_t Size>
+void DSU<Size>::reset(std::size_t i) {
+  parent[i] = i;
+  rank[i] = 1;
+  cluster_size[i] = 1;
+}
 
-DSU::DSU() { init(); }
+template <std::size_t Size>
+DSU<Size>::DSU() {
+  init();
+}
 
 /**
  * @brief Finds and returns the root of a given element in the disjoint set.
@@ -148,7 +250,8 @@ DSU::DSU() { init(); }
  *
  * @return The index of the root element in the disjoint set.
  */
-std::size_t DSU::get_root(std::size_t i) {
+template <std::size_t Size>
+std::size_t DSU<Size>::get_root(std::size_t i) {
   // If the parent of the element is itself, it is the root
   if (parent[i] == i) {
     return i;
@@ -166,13 +269,14 @@ std::size_t DSU::get_root(std::size_t i) {
  * into the other. If the rank of root1 is less than the rank of root2, root1
  * is merged into root2. If the rank of root2 is less than the rank of root1,
  * root2 is merged into root1. If the ranks are equal, root1 is merged into
- * root2 and the rank of root1 is incremented. The cluster size of the merged
+ * root2 and the rank of root2 is incremented. The cluster size of the merged
  * set is updated accordingly.
  *
  * @param i1 The index of the first element in the first disjoint set.
  * @param i2 The index of the second element in the second disjoint set.
  */
-void DSU::make_union(std::size_t i1, std::size_t i2) {
+template <std::size_t Size>
+void DSU<Size>::make_union(std::size_t i1, std::size_t i2) {
   // Get the roots of i1 and i2
   auto root1 = get_root(i1);
   auto root2 = get_root(i2);
@@ -187,18 +291,18 @@ void DSU::make_union(std::size_t i1, std::size_t i2) {
     // Merge root1 into root2
     parent[root1] = root2;
     // Update the cluster size of root2
-    root_to_cluster_size[root2] += root_to_cluster_size[root1];
+    cluster_size[root2] += cluster_size[root1];
   } else if (rank[root2] < rank[root1]) {
     // Merge root2 into root1
     parent[root2] = root1;
     // Update the cluster size of root1
-    root_to_cluster_size[root1] += root_to_cluster_size[root2];
+    cluster_size[root1] += cluster_size[root2];
   } else {
-    // Merge root1 into root2 and increment the rank of root1
+    // Merge root1 into root2 and increment the rank of root2
     parent[root1] = root2;
-    rank[root1]++;
+    rank[root2]++;
     // Update the cluster size of root2
-    root_to_cluster_size[root2] += root_to_cluster_size[root1];
+    cluster_size[root2] += cluster_size[root1];
   }
 }
 
@@ -206,22 +310,142 @@ void DSU::make_union(std::size_t i1, std::size_t i2) {
  * @brief Returns the cluster size of the set containing the element at index i.
  *
  * This function uses the root of the set containing the element at index i to
- * look up the cluster size in the root_to_cluster_size map.
+ * look up the cluster size in the cluster_size array.
  *
  * @param i The index of the element for which the cluster size is to be found.
  *
  * @return The cluster size of the set containing the element at index i.
  */
-std::size_t DSU::get_cluster_size(std::size_t i) {
+template <std::size_t Size>
+std::size_t DSU<Size>::get_cluster_size(std::size_t i) {
   // Get the root of the set containing the element at index i
   std::size_t root = get_root(i);
 
   // Look up the cluster size of the set containing the element at index i in
-  // the root_to_cluster_size map and return it
-  return root_to_cluster_size[root];
+  // the cluster_size array and return it
+  return cluster_size[root];
 }
 
-auto DSU::get_cluster_sizes() const { return root_to_cluster_size; }
+/**
+ * @brief Labels the given cells of the field by their clusters.
+ *
+ * The other cells must keep valid labels, and each of their clusters must
+ * lie among them entirely. The first pass goes over the given cells in
+ * raster order and gives every ball the label of a neighbour of its color
+ * which is labelled already, or a new label of its own, recording the
+ * equivalence of the labels of its other such neighbours in the DSU. The
+ * second pass replaces every label by the root of its equivalence class and
+ * moves the members to the list of the root.
+ *
+ * @param field The game field.
+ * @param unlabelled Tells which cells to label.
+ * @param height The number of rows of the field.
+ * @param width The number of columns of the field.
+ */
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+void ClusterLabels<MaxHeight, MaxWidth>::relabel(
+    const char (&field)[MaxHeight][MaxWidth],
+    const bool (&unlabelled)[MaxHeight * MaxWidth], std::size_t height,
+    std::size_t width) {
+  // Labels of the other cells met in the first pass, at most one for each
+  // pair of neighbouring cells
+  std::size_t kept_labels[2 * MaxHeight * MaxWidth];
+  std::size_t n_kept = 0;
+
+  for (std::size_t i = 0; i < height; i++) {
+    for (std::size_t j = 0; j < width; j++) {
+      std::size_t cell = i * MaxWidth + j;
+      char color = field[i][j];
+      if (!unlabelled[cell]) {
+        continue;
+      }
+      label[cell] = no_label;
+      if (!color) {
+        continue;
+      }
+
+      // Takes the label of a labelled neighbour of the same color
+      auto join = [&](std::size_t neighbour, bool labelled) {
+        if (!labelled ||
+            field[neighbour / MaxWidth][neighbour % MaxWidth] != color) {
+          return;
+        }
+        if (!unlabelled[neighbour]) {
+          kept_labels[n_kept++] = label[neighbour];
+        }
+        if (label[cell] == no_label) {
+          label[cell] = label[neighbour];
+          equivalences.cluster_size[equivalences.get_root(label[cell])]++;
+        } else {
+          equivalences.make_union(label[cell], label[neighbour]);
+        }
+      };
+
+      // The cells above and to the left are labelled already
+      if (i > 0) join(cell - MaxWidth, true);
+      if (j > 0) join(cell - 1, true);
+      if (i + 1 < height) join(cell + MaxWidth, !unlabelled[cell + MaxWidth]);
+      if (j + 1 < width) join(cell + 1, !unlabelled[cell + 1]);
+
+      if (label[cell] == no_label) {
+        equivalences.reset(cell);
+        label[cell] = cell;
+        first_member[cell] = no_label;
+      }
+    }
+  }
+
+  // Move the members of the kept labels which were merged into another one
+  for (std::size_t k = 0; k < n_kept; k++) {
+    std::size_t old_label = kept_labels[k];
+    std::size_t root = equivalences.get_root(old_label);
+    if (root == old_label || first_member[old_label] == no_label) {
+      continue;
+    }
+    std::size_t last = first_member[old_label];
+    while (true) {
+      label[last] = root;
+      if (next_member[last] == no_label) break;
+      last = next_member[last];
+    }
+    next_member[last] = first_member[root];
+    first_member[root] = first_member[old_label];
+    first_member[old_label] = no_label;
+  }
+
+  // Give the new labels their roots and add the cells to their lists
+  for (std::size_t i = 0; i < height; i++) {
+    for (std::size_t j = 0; j < width; j++) {
+      std::size_t cell = i * MaxWidth + j;
+      if (!unlabelled[cell] || label[cell] == no_label) {
+        continue;
+      }
+      std::size_t root = equivalences.get_root(label[cell]);
+      label[cell] = root;
+      next_member[cell] = first_member[root];
+      first_member[root] = cell;
+    }
+  }
+}
+
+/**
+ * @brief Returns the size of the cluster of the ball in the given cell.
+ */
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+std::size_t ClusterLabels<MaxHeight, MaxWidth>::get_cluster_size(
+    std::size_t cell) {
+  return equivalences.get_cluster_size(label[cell]);
+}
+
+template <std::size_t Height, std::size_t Width>
+std::size_t BasicRGBGame<Height, Width>::height() const {
+  return Height == DYNAMIC_SIZE ? height_ : Height;
+}
+
+template <std::size_t Height, std::size_t Width>
+std::size_t BasicRGBGame<Height, Width>::width() const {
+  return Width == DYNAMIC_SIZE ? width_ : Width;
+}
 
 /**
  * @brief Checks if a given point is out of the field.
@@ -236,128 +460,151 @@ auto DSU::get_cluster_sizes() const { return root_to_cluster_size; }
  *
  * @return True if the point is out of the field, false otherwise.
  */
-bool RGB_Game::out_of_field(const Point &point) {
+template <std::size_t Height, std::size_t Width>
+bool BasicRGBGame<Height, Width>::out_of_field(const Point &point) {
   // No need to check for < 0 because std::size_t cannot be negative
   // If the x-coordinate is greater than or equal to the width of the field
   // or the y-coordinate is greater than or equal to the height of the field,
   // the point is out of the field, so return true.
-  return (point.x() >= FIELD_WIDTH || point.y() >= FIELD_HEIGHT);
+  return (point.x() >= width() || point.y() >= height());
 }
 
 /**
  * @brief Clusterizes the game field.
  *
- * This function iterates over each element in the game field and performs
- * clustering based on the union-find algorithm. It checks if the element is
- * non-zero and then checks its neighbors to form clusters. If two adjacent
- * elements are the same color, they are unioned together in the union-find
- * data structure.
+ * This function labels every cell of the game field by its cluster, so the
+ * balls of the same color next to each other share a label.
  *
  * @throws None
  */
-void RGB_Game::clusterize_field() {
-  // Iterate over each element in the game field
-  for (std::size_t i = 0; i < FIELD_HEIGHT; ++i) {
-    for (std::size_t j = 0; j < FIELD_WIDTH; ++j) {
-      // Skip if the element is zero
-      if (!game_field[i][j]) continue;
-
-      // Define a lambda function to check and union adjacent elements
-      auto make_union = [&](std::size_t dx, std::size_t dy) {
-        // Get the neighboring element, considering out-of-field boundaries
-        char neighbour_elem = out_of_field(Point(j + dx, i + dy))
-                                  ? 0
-                                  : game_field[i + dy][j + dx];
-        // If the neighboring element exists and is the same color, union them
-        if (neighbour_elem && neighbour_elem == game_field[i][j]) {
-          field_dsu.make_union(i * FIELD_WIDTH + j,
-                               (i + dy) * FIELD_WIDTH + j + dx);
-        }
-      };
-
-      // Check and union adjacent elements in different directions
-      make_union(0, -1);  // Up
-      make_union(1, 0);   // Right
-      make_union(0, 1);   // Down
-      make_union(-1, 0);  // Left
-    }
-  }
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::clusterize_field() {
+  // Label every cell of the game field
+  bool all_cells[max_height * max_width];
+  std::fill(all_cells, all_cells + max_height * max_width, true);
+  field_labels.relabel(game_field, all_cells, height(), width());
 }
 
 /**
  * @brief Shifts non-zero elements in each row upwards.
  *
- * This function iterates over each column of the game field and shifts non-zero
- * elements upwards until they reach the top of the row.
+ * This function lets the balls of every column fall to the bottom of the
+ * field in one pass per column: the balls are copied down in order over the
+ * empty cells, and the cells above the last one are cleared.
  *
  * @param game_field The game field to operate on.
+ * @param height The number of rows of the field.
+ * @param width The number of columns of the field.
  */
-void shift_raw_elems(char (&game_field)[FIELD_HEIGHT][FIELD_WIDTH]) {
-  std::size_t counter = 0;
-
-  // The maximum number of shifts is FIELD_HEIGHT because each row can have at
-  // most FIELD_HEIGHT non-zero elements.
-  while (counter < FIELD_HEIGHT) {
-    // Iterate over each column of the game field
-    for (std::size_t i = 0; i < FIELD_WIDTH; ++i) {
-      // Iterate over each element in the current column from the bottom up
-      for (std::size_t j = FIELD_HEIGHT - 1; j > 0; --j) {
-        // If the current element is zero and the element below it is non-zero,
-        // swap them
-        if (!game_field[j][i] && game_field[j - 1][i]) {
-          std::swap(game_field[j][i], game_field[j - 1][i]);
-        }
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+static void shift_raw_elems(char (&game_field)[MaxHeight][MaxWidth],
+                            std::size_t height, std::size_t width) {
+  // Iterate over each column of the game field
+  for (std::size_t i = 0; i < width; ++i) {
+    // Copy the balls from the bottom up to the lowest free row
+    std::size_t free_row = height;
+    for (std::size_t j = height; j-- > 0;) {
+      if (game_field[j][i]) {
+        game_field[--free_row][i] = game_field[j][i];
       }
     }
 
-    // Increment the counter after each iteration
-    ++counter;
+    // Clear the cells above the balls
+    for (std::size_t j = 0; j < free_row; ++j) {
+      game_field[j][i] = 0;
+    }
   }
 }
 
+#ifdef RGB_GAME_SSSE3
+
+/**
+ * @brief Checks once whether the processor supports SSSE3.
+ */
+static bool ssse3_supported() {
+  static const bool supported = __builtin_cpu_supports("ssse3");
+  return supported;
+}
+
+/**
+ * @brief Moves the bytes of every row to the positions given by a shuffle
+ * control, one row per byte shuffle.
+ *
+ * @param control Byte k of a row becomes its byte control[k], or 0 if the
+ * high bit of control[k] is set.
+ */
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+__attribute__((target("ssse3"))) static void shuffle_rows_ssse3(
+    char (&game_field)[MaxHeight][MaxWidth], std::size_t height,
+    const char (&control)[16]) {
+  static_assert(MaxWidth <= 16, "A row must fit in one byte shuffle");
+  __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(control));
+  for (std::size_t i = 0; i < height; ++i) {
+    // A row may be shorter than a vector, so it goes through a buffer
+    alignas(16) char bytes[16] = {};
+    std::memcpy(bytes, game_field[i], MaxWidth);
+    __m128i packed = _mm_shuffle_epi8(
+        _mm_load_si128(reinterpret_cast<const __m128i *>(bytes)), shuffle);
+    _mm_store_si128(reinterpret_cast<__m128i *>(bytes), packed);
+    std::memcpy(game_field[i], bytes, MaxWidth);
+  }
+}
+
+#endif
+
 /**
  * @brief Shifts non-zero elements in each column to the left.
  *
- * This function iterates over each column of the game field and shifts non-zero
- * elements to the left until they reach the leftmost position.
+ * This function finds the columns with balls, then moves them to the left in
+ * order by a prefix scan over them, and clears the columns after them. Rows
+ * of up to 16 bytes are moved by one byte shuffle each.
  *
  * @param game_field The game field to operate on.
+ * @param height The number of rows of the field.
+ * @param width The number of columns of the field.
  */
-void shift_column_elems(char (&game_field)[FIELD_HEIGHT][FIELD_WIDTH]) {
-  /**
-   * @brief Checks if a column is empty.
-   *
-   * This lambda function checks if a column is empty by iterating over each
-   * element in the column and returning false if any element is non-zero.
-   *
-   * @param i The index of the column.
-   * @return true if the column is empty, false otherwise.
-   */
-  auto column_is_empty = [&](std::size_t i) {
-    for (std::size_t j = 0; j < FIELD_HEIGHT; ++j) {
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+static void shift_column_elems(char (&game_field)[MaxHeight][MaxWidth],
+                               std::size_t height, std::size_t width) {
+  // Byte k of a row is taken from column control[k] of the row, or cleared if
+  // the high bit is set
+  char control[MaxWidth > 16 ? MaxWidth : 16];
+  std::size_t n_columns = 0;
+  for (std::size_t i = 0; i < width; ++i) {
+    for (std::size_t j = 0; j < height; ++j) {
       if (game_field[j][i]) {
-        return false;
+        control[n_columns++] = static_cast<char>(i);
+        break;
       }
     }
-    return true;
-  };
-
-  std::size_t counter = 0;
-  // The maximum number of shifts is FIELD_WIDTH because we have FIELD_WIDTH
-  // amount of columns.
-  while (counter < FIELD_WIDTH) {
-    // Iterate over each column from the leftmost to the second-to-last column
-    for (std::size_t i = 0; i < FIELD_WIDTH - 1; ++i) {
-      // If the current column is empty, shift all elements to the left
-      if (column_is_empty(i)) {
-        for (std::size_t j = 0; j < FIELD_HEIGHT; ++j) {
-          std::swap(game_field[j][i], game_field[j][i + 1]);
-        }
-      }
+  }
+  // The columns are in order, so they are the first ones if the last one is
+  if (n_columns == 0 ||
+      static_cast<std::size_t>(control[n_columns - 1]) == n_columns - 1) {
+    // The columns with balls are already the first ones; clear the others
+    for (std::size_t i = 0; i < height; ++i) {
+      std::fill(game_field[i] + n_columns, game_field[i] + width, 0);
+    }
+    return;
+  }
+
+#ifdef RGB_GAME_SSSE3
+  if constexpr (MaxWidth <= 16) {
+    if (ssse3_supported()) {
+      std::fill(control + n_columns, control + 16, static_cast<char>(0x80));
+      shuffle_rows_ssse3(game_field, height, control);
+      return;
     }
+  }
+#endif
 
-    // Increment the counter after each iteration
-    ++counter;
+  // Iterate over each row, moving the columns with balls to the left
+  for (std::size_t i = 0; i < height; ++i) {
+    char *row = game_field[i];
+    for (std::size_t k = 0; k < n_columns; ++k) {
+      row[k] = row[static_cast<std::size_t>(control[k])];
+    }
+    std::fill(row + n_columns, row + width, 0);
   }
 }
 
@@ -365,12 +612,13 @@ void shift_column_elems(char (&game_field)[FIELD_HEIGHT][FIELD_WIDTH]) {
  * @brief Updates the game field by shifting non-zero elements upwards and
  * shifting non-zero elements to the left.
  */
-void RGB_Game::update_field() {
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::update_field() {
   // Shift non-zero elements upwards in each row
-  shift_raw_elems(game_field);
+  shift_raw_elems(game_field, height(), width());
 
   // Shift non-zero elements to the left in each column
-  shift_column_elems(game_field);
+  shift_column_elems(game_field, height(), width());
 }
 
 /**
@@ -384,7 +632,8 @@ void RGB_Game::update_field() {
  * @return The best move as a Point object, where the x-coordinate represents
  * the column index and the y-coordinate represents the row index.
  */
-Point RGB_Game::choose_move() {
+template <std::size_t Height, std::size_t Width>
+Point BasicRGBGame<Height, Width>::choose_move() {
   // Initialize the best move to (-1, 0) to indicate that no move has been found
   // overflow because of std::size_t
   Point best_move = Point(-1, 0);
@@ -394,13 +643,13 @@ Point RGB_Game::choose_move() {
 
   // Iterate over each column and each row from the bottom to the second-to-top
   // row this iteration is according to the rules of choosing move from the task
-  for (std::size_t j = 0; j < FIELD_WIDTH; ++j) {
-    for (std::size_t i = FIELD_HEIGHT - 1; i > 0; --i) {
+  for (std::size_t j = 0; j < width(); ++j) {
+    for (std::size_t i = height() - 1; i > 0; --i) {
       // If a non-zero element is found
       if (game_field[i][j]) {
-        // Calculate the cluster size of the element using the DSU
+        // Look up the cluster size of the element by its label
         std::size_t cluster_size =
-            field_dsu.get_cluster_size(i * FIELD_WIDTH + j);
+            field_labels.get_cluster_size(i * max_width + j);
 
         // If the cluster size is greater than the current maximum cluster size
         if (cluster_size > max_cluster_size) {
@@ -417,7 +666,95 @@ Point RGB_Game::choose_move() {
 }
 
 /**
- * @brief Constructs a new RGB_Game object.
+ * @brief Tells whether a move may be made at the given point.
+ *
+ * It may if the ball there is in a cluster of more than 2 balls with a ball
+ * below the top row, the clusters list_moves lists.
+ *
+ * @param point The point, inside the field.
+ */
+template <std::size_t Height, std::size_t Width>
+bool BasicRGBGame<Height, Width>::is_move(const Point &point) {
+  constexpr std::size_t no_label = decltype(field_labels)::no_label;
+
+  if (!game_field[point.y()][point.x()]) {
+    return false;
+  }
+  std::size_t label = field_labels.label[point.y() * max_width + point.x()];
+  if (field_labels.get_cluster_size(label) <= 2) {
+    return false;
+  }
+  for (std::size_t cell = field_labels.first_member[label]; cell != no_label;
+       cell = field_labels.next_member[cell]) {
+    if (cell >= max_width) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Returns the size of the cluster of the ball at the given point.
+ */
+template <std::size_t Height, std::size_t Width>
+std::size_t BasicRGBGame<Height, Width>::get_cluster_size(const Point &point) {
+  return field_labels.get_cluster_size(point.y() * max_width + point.x());
+}
+
+/**
+ * @brief Lists all moves of the field in one scan.
+ *
+ * The scan is the one of choose_move, and a cluster is listed at the first
+ * of its balls it meets, with the size its label holds; the clusters of
+ * more than 2 balls with a ball below the top row are the moves.
+ *
+ * @param moves Receives the moves; its old content is dropped.
+ */
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::list_moves(
+    std::vector<ClusterMove> &moves) {
+  constexpr std::size_t cells = max_height * max_width;
+
+  // Bit l is set once the cluster labelled l is listed
+  std::uint64_t seen[(cells + 63) / 64] = {};
+
+  moves.clear();
+  for (std::size_t j = 0; j < width(); ++j) {
+    for (std::size_t i = height() - 1; i > 0; --i) {
+      if (!game_field[i][j]) {
+        continue;
+      }
+      std::size_t label = field_labels.label[i * max_width + j];
+      std::size_t cluster_size = field_labels.get_cluster_size(label);
+      std::uint64_t bit = std::uint64_t(1) << (label % 64);
+      if (cluster_size > 2 && !(seen[label / 64] & bit)) {
+        seen[label / 64] |= bit;
+        moves.push_back({Point(j, i), game_field[i][j], cluster_size});
+      }
+    }
+  }
+}
+
+/**
+ * @brief Puts a ball on the game field.
+ *
+ * @param i The row of the ball.
+ * @param j The column of the ball.
+ * @param ball The color of the ball.
+ * @throws std::invalid_argument If the ball is not a valid character.
+ */
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::set_cell(std::size_t i, std::size_t j,
+                                           char ball) {
+  // Check if the ball is a valid character
+  if (!chars_allowed[ball]) {
+    throw std::invalid_argument("Invalid char in field");
+  }
+  game_field[i][j] = ball;
+}
+
+/**
+ * @brief Constructs a new game on a field of the largest size.
  *
  * This constructor initializes the game field with the given field data and
  * performs the clustering operation on the game field.
@@ -426,43 +763,73 @@ Point RGB_Game::choose_move() {
  * @throws std::invalid_argument If any element in the field is not a valid
  *         character.
  */
-RGB_Game::RGB_Game(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]) {
+template <std::size_t Height, std::size_t Width>
+BasicRGBGame<Height, Width>::BasicRGBGame(
+    char (&field)[max_height][max_width]) {
   // Iterate over each element in the field and populate the game field
-  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
-    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
-      // Check if the current element is a valid character
-      if (!chars_allowed[field[i][j]]) {
-        throw std::invalid_argument("Invalid char in field");
-      }
-      // Populate the game field with the current element
-      game_field[i][j] = field[i][j];
+  for (std::size_t i = 0; i < max_height; i++) {
+    for (std::size_t j = 0; j < max_width; j++) {
+      set_cell(i, j, field[i][j]);
     }
   }
 
-  // Initialize the DSU object
-  field_dsu = DSU();
   // Perform the clustering operation on the game field
   clusterize_field();
 }
 
-auto RGB_Game::get_field() { return game_field; }
+/**
+ * @brief Constructs a new game on a field given by its rows.
+ *
+ * @param rows The rows of the game field, from the top one.
+ * @throws std::invalid_argument If the field has a size the game can not be
+ *         played on, or any element in it is not a valid character.
+ */
+template <std::size_t Height, std::size_t Width>
+BasicRGBGame<Height, Width>::BasicRGBGame(
+    const std::vector<std::string> &rows) {
+  height_ = rows.size();
+  width_ = rows.empty() ? 0 : rows[0].size();
+  bool fits = height_ > 0 && height_ <= max_height && width_ > 0 &&
+              width_ <= max_width;
+  fits = fits && (Height == DYNAMIC_SIZE || height_ == Height) &&
+         (Width == DYNAMIC_SIZE || width_ == Width);
+  for (const auto &row : rows) {
+    fits = fits && row.size() == width_;
+  }
+  if (!fits) {
+    throw std::invalid_argument("Invalid field size");
+  }
+
+  // Iterate over each element in the rows and populate the game field
+  for (std::size_t i = 0; i < height_; i++) {
+    for (std::size_t j = 0; j < width_; j++) {
+      set_cell(i, j, rows[i][j]);
+    }
+  }
+
+  // Perform the clustering operation on the game field
+  clusterize_field();
+}
+
+template <std::size_t Height, std::size_t Width>
+auto BasicRGBGame<Height, Width>::get_field() {
+  return game_field;
+}
 
 /**
  * @brief Plays the game.
  *
  * This function implements the main game loop. It repeatedly calls the
  * choose_move() function to determine the next move, and then calls the
- * make_move() function to make the move. It keeps track of the move count
- * and updates the game state after each move. The game loop continues until
- * the choose_move() function returns a Point object with x=-1.
+ * make_move() function to make the move, and updates the game state after
+ * each move. The game loop continues until the choose_move() function
+ * returns a Point object with x=-1.
  *
  * After the game loop exits, the function calculates the final score and
- * writes it to the game log.
+ * records it.
  */
-void RGB_Game::play() {
-  // Initialize the move count
-  std::size_t move_count = 1;
-
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::play() {
   // Game loop
   while (1) {
     // Choose the next move
@@ -474,7 +841,7 @@ void RGB_Game::play() {
     }
 
     // Make the move and update the game state
-    make_move(move_count++, move);
+    make_move(move);
     update();
   }
 
@@ -482,52 +849,94 @@ void RGB_Game::play() {
   std::size_t n_balls = count_balls_on_field();
   total_score = (n_balls == 0) ? total_score + 1000 : total_score;
 
-  // Write the final score to the game log
-  game_log << "Final score " << total_score << " with " << n_balls
-           << " balls remaining\n";
+  // Record the final score
+  game_record.finish(total_score, n_balls);
+}
+
+/**
+ * @brief Plays the game with the moves the strategy chooses.
+ *
+ * The moves are listed once per turn for the strategy, which ends the game
+ * when it chooses none or no move is left; the final score is recorded as
+ * by play().
+ *
+ * @param strategy The strategy; a GreedyStrategy plays as play() does.
+ */
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::play(MoveStrategy &strategy) {
+  std::vector<ClusterMove> moves;
+  while (true) {
+    list_moves(moves);
+    if (moves.empty()) {
+      break;
+    }
+    std::size_t chosen = strategy.choose(moves);
+    if (chosen >= moves.size()) {
+      break;
+    }
+    make_move(moves[chosen].anchor);
+    update();
+  }
+
+  std::size_t n_balls = count_balls_on_field();
+  total_score = (n_balls == 0) ? total_score + 1000 : total_score;
+  game_record.finish(total_score, n_balls);
+}
+
+/**
+ * @brief Returns the moves and the outcome of the game as structs.
+ */
+template <std::size_t Height, std::size_t Width>
+const GameRecord &BasicRGBGame<Height, Width>::get_record() const {
+  return game_record;
 }
 
-std::string RGB_Game::dumps_log() { return game_log.str(); }
+/**
+ * @brief Formats the log of the game from its record.
+ */
+template <std::size_t Height, std::size_t Width>
+std::string BasicRGBGame<Height, Width>::dumps_log() {
+  return game_record.dumps_log();
+}
 
 /**
  * @brief Makes a move at the given point and updates the game state.
  *
- * @param move_count The number of moves made so far.
  * @param point The point where the move is made.
  *
  * This function performs the following steps:
  * 1. Finds the color of the ball at the given point.
- * 2. Iterates over the entire game field and checks if the ball at the
- *    current position is part of the same connected component as the ball at
- *    the given point.
- * 3. If a ball is part of the same connected component, it is marked as erased
- *    and the number of erased balls is incremented.
+ * 2. Walks the member list of the cluster of the ball at the given point.
+ * 3. Every ball of the list is marked as erased and the number of erased
+ *    balls is incremented.
  * 4. Calculates the number of acquired points by subtracting 2 from the total
  *    number of erased balls and then squaring the result.
  * 5. Updates the total score by adding the number of acquired points.
- * 6. Writes a log message to the game log indicating the move that was made
- *    and the number of points gained.
+ * 6. Records the move that was made and the number of points gained.
  */
-void RGB_Game::make_move(std::size_t move_count, const Point &point) {
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::make_move(const Point &point) {
+  constexpr std::size_t no_label = decltype(field_labels)::no_label;
+
   // Initialize the number of erased balls to 0
   std::size_t n_erased = 0;
 
   // Get the color of the ball at the given point
   char color = game_field[point.y()][point.x()];
 
-  // Iterate over the entire game field
-  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
-    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
-      // Check if the ball at the current position is part of the same
-      // connected component as the ball at the given point
-      if (field_dsu.get_root(i * FIELD_WIDTH + j) ==
-          field_dsu.get_root(point.y() * FIELD_WIDTH + point.x())) {
-        // Mark the ball as erased and increment the number of erased balls
-        game_field[i][j] = 0;
-        n_erased++;
-      }
-    }
+  // Get the label of the cluster of the ball at the given point
+  std::size_t label = field_labels.label[point.y() * max_width + point.x()];
+
+  // Iterate over the balls of the cluster
+  for (std::size_t cell = field_labels.first_member[label]; cell != no_label;
+       cell = field_labels.next_member[cell]) {
+    // Mark the ball as erased and increment the number of erased balls
+    game_field[cell / max_width][cell % max_width] = 0;
+    field_labels.label[cell] = no_label;
+    n_erased++;
+    touched_columns |= std::uint64_t(1) << (cell % max_width);
   }
+  field_labels.first_member[label] = no_label;
 
   // Calculate the number of acquired points
   std::size_t acquired_points = (n_erased - 2) * (n_erased - 2);
@@ -535,35 +944,81 @@ void RGB_Game::make_move(std::size_t move_count, const Point &point) {
   // Update the total score by adding the number of acquired points
   total_score += acquired_points;
 
-  // Write a log message to the game log indicating the move that was made and
-  // the number of points gained
-  // [FIELD_HEIGHT - point.y()] and [point.x() + 1] because of the
+  // Record the move that was made and the number of points gained
+  // [height() - point.y()] and [point.x() + 1] because of the
   // relation of the coordinate basises in the algorithm and in the task
-  game_log << "Move " << move_count << " at (" << FIELD_HEIGHT - point.y()
-           << ", " << point.x() + 1 << ")" << ": removed " << n_erased
-           << " balls of color " << color << ", got " << acquired_points
-           << " points\n";
+  game_record.add_move({static_cast<std::uint8_t>(height() - point.y()),
+                        static_cast<std::uint8_t>(point.x() + 1), color,
+                        static_cast<std::uint16_t>(n_erased),
+                        static_cast<std::uint32_t>(acquired_points)});
 }
 
 /**
- * @brief Updates the game field and resets the Disjoint Set Union.
+ * @brief Updates the game field and reclusterizes the part which changed.
  *
- * This function updates the game field by calling the `update_field` method and
- * then resets the Disjoint Set Union by calling the `reset` method of the
- * `field_dsu` object. It also clusterizes the field by calling the
- * `clusterize_field` method.
+ * Only the columns the last move erased balls in and the columns which shift
+ * left change. The clusters with a ball in those columns are relabelled,
+ * including their balls in the other columns, which are found by their
+ * member lists; the other clusters keep their labels, and grow in place when
+ * a relabelled ball joins them.
  *
  * @throws None
  */
-void RGB_Game::update() {
+template <std::size_t Height, std::size_t Width>
+void BasicRGBGame<Height, Width>::update() {
+  constexpr std::size_t no_label = decltype(field_labels)::no_label;
+
+  // Find the first empty column with balls to its right; it and all columns
+  // after it shift left
+  std::size_t first_empty = width();
+  std::size_t first_shifted = width();
+  for (std::size_t j = 0; j < width(); j++) {
+    bool column_is_empty = true;
+    for (std::size_t i = 0; i < height() && column_is_empty; i++) {
+      column_is_empty = !game_field[i][j];
+    }
+    if (column_is_empty && first_empty == width()) {
+      first_empty = j;
+    } else if (!column_is_empty && first_empty != width()) {
+      first_shifted = first_empty;
+      break;
+    }
+  }
+
+  bool affected[max_width];
+  for (std::size_t j = 0; j < width(); j++) {
+    affected[j] = j >= first_shifted || ((touched_columns >> j) & 1);
+  }
+  touched_columns = 0;
+
+  // Mark the cells to relabel: the cells of the affected columns, and the
+  // cells of their clusters in the other columns, which do not move
+  bool dirty[max_height * max_width];
+  bool walked[max_height * max_width] = {};
+  for (std::size_t i = 0; i < height(); i++) {
+    for (std::size_t j = 0; j < width(); j++) {
+      dirty[i * max_width + j] = affected[j];
+    }
+  }
+  for (std::size_t i = 0; i < height(); i++) {
+    for (std::size_t j = 0; j < width(); j++) {
+      std::size_t label = field_labels.label[i * max_width + j];
+      if (!affected[j] || label == no_label || walked[label]) {
+        continue;
+      }
+      walked[label] = true;
+      for (std::size_t member = field_labels.first_member[label];
+           member != no_label; member = field_labels.next_member[member]) {
+        dirty[member] = true;
+      }
+    }
+  }
+
   // Update the game field
   update_field();
 
-  // Reset the Disjoint Set Union
-  field_dsu.reset();
-
-  // Clusterize the game field
-  clusterize_field();
+  // Label the marked cells again
+  field_labels.relabel(game_field, dirty, height(), width());
 }
 
 /**
@@ -575,12 +1030,13 @@ void RGB_Game::update() {
  *
  * @return The total number of balls on the game field.
  */
-std::size_t RGB_Game::count_balls_on_field() {
+template <std::size_t Height, std::size_t Width>
+std::size_t BasicRGBGame<Height, Width>::count_balls_on_field() {
   std::size_t count = 0;  // Initialize the counter to 0
 
   // Iterate over each cell of the game field
-  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
-    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
+  for (std::size_t i = 0; i < height(); i++) {
+    for (std::size_t j = 0; j < width(); j++) {
       // If the current cell has a non-zero value, increment the counter
       if (game_field[i][j]) {
         count++;
@@ -592,4 +1048,8 @@ std::size_t RGB_Game::count_balls_on_field() {
   return count;
 }
 
-}  // namespace RGB_Game
\ No newline at end of file
+// The games handle_rgb_game plays: the default field, and any field
+template class BasicRGBGame<FIELD_HEIGHT, FIELD_WIDTH>;
+template class BasicRGBGame<DYNAMIC_SIZE, DYNAMIC_SIZE>;
+
+}  // namespace RGB_Game
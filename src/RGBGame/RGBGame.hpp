@@ -1,12 +1,24 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <unordered_map>
+#include <vector>
+
+#include "GameRecord.hpp"
 
 #define FIELD_WIDTH 15
 #define FIELD_HEIGHT 10
 
+// Largest field a game can be played on
+#define MAX_FIELD_WIDTH 64
+#define MAX_FIELD_HEIGHT 64
+
+// Dimension of a field which is given at runtime
+#define DYNAMIC_SIZE 0
+
 namespace RGB_Game {
 
 class Point {
@@ -32,11 +44,61 @@ struct PointHash {
   std::size_t operator()(const Point &point) const;
 };
 
+/**
+ * @brief A cluster a move may remove.
+ *
+ * The anchor is the first ball of the cluster which choose_move's scan
+ * meets, the column in x and the row from the top in y; the move is made
+ * and logged there.
+ */
+struct ClusterMove {
+  Point anchor;
+  char colour;
+  std::size_t size;
+};
+
+/**
+ * @brief Chooses the moves of a game played by BasicRGBGame::play.
+ */
+class MoveStrategy {
+ public:
+  virtual ~MoveStrategy() = default;
+
+  /**
+   * @brief Chooses one of the moves the field allows.
+   *
+   * @param moves The moves, never empty, in the order of list_moves.
+   * @return The index of the chosen move, or moves.size() to end the game.
+   */
+  virtual std::size_t choose(const std::vector<ClusterMove> &moves) = 0;
+};
+
+/**
+ * @brief The rule of the task: the first of the largest clusters.
+ */
+class GreedyStrategy : public MoveStrategy {
+ public:
+  std::size_t choose(const std::vector<ClusterMove> &moves) override;
+};
+
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+class ClusterLabels;
+
+template <std::size_t Height, std::size_t Width>
+class BasicRGBGame;
+
+template <std::size_t Height, std::size_t Width>
+class BasicGameSession;
+
+/**
+ * @brief Disjoint Set Union over the given number of elements.
+ */
+template <std::size_t Size>
 class DSU {
  private:
-  std::size_t parent[FIELD_HEIGHT * FIELD_WIDTH];
-  std::size_t rank[FIELD_HEIGHT * FIELD_WIDTH];
-  std::unordered_map<std::size_t, std::size_t> root_to_cluster_size;
+  std::size_t parent[Size];
+  std::size_t rank[Size];
+  std::size_t cluster_size[Size];
 
   void init();
 
@@ -44,6 +106,7 @@ class DSU {
   DSU();
 
   void reset();
+  void reset(std::size_t i);
 
   void make_union(std::size_t i1, std::size_t i2);
 
@@ -51,39 +114,117 @@ class DSU {
 
   std::size_t get_cluster_size(std::size_t i);
 
-  auto get_cluster_sizes() const;
+  template <std::size_t, std::size_t>
+  friend class ClusterLabels;
+};
+
+/**
+ * @brief Connected-component labelling of the field in flat arrays.
+ *
+ * The cell in row i and column j has the index i * MaxWidth + j. Every ball
+ * carries the label of its cluster, which is the index of one of the cells
+ * of the cluster. The label is a root of the DSU, which holds the size of
+ * the cluster, and heads the list of the cells of the cluster, linked
+ * through next_member.
+ */
+template <std::size_t MaxHeight, std::size_t MaxWidth>
+class ClusterLabels {
+ public:
+  // Label of an empty cell, and end of a member list
+  static constexpr std::size_t no_label = MaxHeight * MaxWidth;
+
+ private:
+  DSU<MaxHeight * MaxWidth> equivalences;
+  std::size_t label[MaxHeight * MaxWidth];
+  std::size_t first_member[MaxHeight * MaxWidth];
+  std::size_t next_member[MaxHeight * MaxWidth];
+
+ public:
+  void relabel(const char (&field)[MaxHeight][MaxWidth],
+               const bool (&unlabelled)[MaxHeight * MaxWidth],
+               std::size_t height, std::size_t width);
+
+  std::size_t get_cluster_size(std::size_t cell);
 
-  friend class RGB_Game;
+  template <std::size_t, std::size_t>
+  friend class BasicRGBGame;
 };
 
-class RGB_Game {
+/**
+ * @brief The RGB game on a field of Height rows and Width columns.
+ *
+ * A dimension which is DYNAMIC_SIZE is given at runtime, up to
+ * MAX_FIELD_HEIGHT rows or MAX_FIELD_WIDTH columns. The fixed dimensions
+ * are compile-time constants, so RGB_Game, the instantiation for the
+ * default field, loses nothing to the dynamic one.
+ */
+template <std::size_t Height, std::size_t Width>
+class BasicRGBGame {
+ public:
+  // Rows and columns the field has room for
+  static constexpr std::size_t max_height =
+      Height == DYNAMIC_SIZE ? MAX_FIELD_HEIGHT : Height;
+  static constexpr std::size_t max_width =
+      Width == DYNAMIC_SIZE ? MAX_FIELD_WIDTH : Width;
+
+  static_assert(max_width <= 64, "A column must have a bit in a word");
+
  private:
-  DSU field_dsu;
-  char game_field[FIELD_HEIGHT][FIELD_WIDTH];
+  ClusterLabels<max_height, max_width> field_labels;
+  char game_field[max_height][max_width];
+  std::size_t height_ = max_height;
+  std::size_t width_ = max_width;
   std::size_t total_score = 0;
-  std::stringstream game_log;
+  GameRecord game_record;
+
+  // Bit j is set if the last move erased a ball in column j
+  std::uint64_t touched_columns = 0;
+
+  std::size_t height() const;
+  std::size_t width() const;
 
   bool out_of_field(const Point &point);
 
   std::size_t count_balls_on_field();
 
   Point choose_move();
+  bool is_move(const Point &point);
+  std::size_t get_cluster_size(const Point &point);
 
+  void set_cell(std::size_t i, std::size_t j, char ball);
   void clusterize_field();
   void update_field();
   void update();
-  void make_move(std::size_t move_count, const Point &point);
+  void make_move(const Point &point);
 
  public:
-  RGB_Game(char (&field)[FIELD_HEIGHT][FIELD_WIDTH]);
+  BasicRGBGame(char (&field)[max_height][max_width]);
+  BasicRGBGame(const std::vector<std::string> &rows);
 
   auto get_field();
 
+  void list_moves(std::vector<ClusterMove> &moves);
+
   void play();
+  void play(MoveStrategy &strategy);
+
+  const GameRecord &get_record() const;
 
   std::string dumps_log();
+
+  template <std::size_t, std::size_t>
+  friend class BasicGameSession;
 };
 
+// The game on the default field, and on a field of any size
+using RGB_Game = BasicRGBGame<FIELD_HEIGHT, FIELD_WIDTH>;
+using DynamicRGBGame = BasicRGBGame<DYNAMIC_SIZE, DYNAMIC_SIZE>;
+
+struct SearchConfig;
+
 std::string handle_rgb_game(std::istream &input);
+std::string handle_rgb_game(std::istream &input, const SearchConfig &config);
+std::string handle_rgb_game(std::istream &input, std::size_t height,
+                            std::size_t width, const SearchConfig &config);
 
 }  // namespace RGB_Game
\ No newline at end of file
@@ -0,0 +1,545 @@
+#include "Search.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "TranspositionTable.hpp"
+
+// Weight of the exploration term of UCT, for scores scaled to [0, 1]
+#define UCT_EXPLORATION 0.5
+
+namespace RGB_Game {
+
+// Index of no move or no node
+static const std::size_t none = std::numeric_limits<std::size_t>::max();
+
+/**
+ * @brief Tells when the time budget of a search has run out.
+ */
+class SearchDeadline {
+ private:
+  std::chrono::steady_clock::time_point end_;
+  bool limited_;
+
+ public:
+  explicit SearchDeadline(double seconds) : limited_(seconds > 0) {
+    if (limited_) {
+      end_ = std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                 std::chrono::duration<double>(seconds));
+    }
+  }
+
+  bool passed() const {
+    return limited_ && std::chrono::steady_clock::now() >= end_;
+  }
+};
+
+/**
+ * @brief The best sequence of moves found so far and its final score.
+ */
+struct SearchPlan {
+  std::vector<BitboardMove> moves;
+  std::size_t score = 0;
+};
+
+/**
+ * @brief Returns the final score of a game which ended on the field.
+ */
+static std::size_t final_score(const BitboardField &field,
+                               std::size_t score) {
+  return field.count_balls_on_field() == 0 ? score + CLEAR_BONUS : score;
+}
+
+/**
+ * @brief Plays the greedy moves to the end of the game.
+ *
+ * @param score The points of the moves played before.
+ * @param moves Receives the moves played, if not null.
+ * @return The final score.
+ */
+static std::size_t complete_greedily(BitboardField field, std::size_t score,
+                                     std::vector<BitboardMove> *moves) {
+  BitboardMove move;
+  while (field.choose_move(move)) {
+    field.make_move(move);
+    score += move.points();
+    if (moves) {
+      moves->push_back(move);
+    }
+  }
+  return final_score(field, score);
+}
+
+/**
+ * @brief Tells whether the search reached a field before with at least as
+ * many points, or as many points in no more moves, and records the field
+ * otherwise.
+ *
+ * The same field has the same moves ahead, so the position reached second
+ * can not lead to a better game and is skipped.
+ *
+ * @param table The fields reached so far, or null to record none.
+ * @param score The points of the moves which reached the field.
+ * @param depth The number of those moves.
+ */
+static bool reached_before(TranspositionTable *table,
+                           const BitboardField &field, std::size_t score,
+                           std::size_t depth) {
+  if (!table) {
+    return false;
+  }
+  TranspositionEntry entry;
+  if (table->probe(field.hash(), entry) &&
+      (entry.score > score || (entry.score == score && entry.depth <= depth))) {
+    return true;
+  }
+  table->store(field.hash(), {static_cast<std::uint32_t>(score),
+                              static_cast<std::uint32_t>(depth)});
+  return false;
+}
+
+/**
+ * @brief A move of the beam search and the index of the move before it.
+ */
+struct BeamStep {
+  std::size_t parent;
+  BitboardMove move;
+};
+
+/**
+ * @brief A position of the beam: the field after some moves, rated by the
+ * final score of its greedy completion.
+ */
+struct BeamPosition {
+  BitboardField field;
+  std::size_t score;
+  std::size_t step;  // index of the last move, none at the start
+  std::size_t rating;
+};
+
+/**
+ * @brief Returns the moves which lead to a step, the first move first.
+ */
+static std::vector<BitboardMove> trace_steps(
+    const std::vector<BeamStep> &steps, std::size_t step) {
+  std::vector<BitboardMove> moves;
+  for (; step != none; step = steps[step].parent) {
+    moves.push_back(steps[step].move);
+  }
+  std::reverse(moves.begin(), moves.end());
+  return moves;
+}
+
+/**
+ * @brief Searches the moves by the beam of the beam_width best rated
+ * positions after each number of moves.
+ *
+ * Every child of the beam which reaches a new field is rated by a greedy
+ * completion, and the best completion seen is the plan.
+ */
+static SearchPlan beam_search(const BitboardField &field,
+                              const SearchConfig &config,
+                              const SearchDeadline &deadline,
+                              TranspositionTable *table, SearchPlan plan) {
+  std::size_t width = std::max<std::size_t>(config.beam_width, 1);
+  std::vector<BeamStep> steps;
+  std::vector<BeamPosition> beam{{field, 0, none, plan.score}};
+  std::vector<BeamPosition> children;
+  std::vector<BitboardMove> moves;
+  reached_before(table, field, 0, 0);
+
+  for (std::size_t depth = 1; !beam.empty(); depth++) {
+    children.clear();
+    for (const auto &position : beam) {
+      position.field.list_moves(moves);
+      for (const auto &move : moves) {
+        if (deadline.passed()) {
+          return plan;
+        }
+
+        BeamPosition child{position.field, position.score + move.points(),
+                           steps.size(), 0};
+        child.field.make_move(move);
+        if (reached_before(table, child.field, child.score, depth)) {
+          continue;
+        }
+        steps.push_back({position.step, move});
+        child.rating = complete_greedily(child.field, child.score, nullptr);
+        if (child.rating > plan.score) {
+          plan.moves = trace_steps(steps, child.step);
+          complete_greedily(child.field, child.score, &plan.moves);
+          plan.score = child.rating;
+        }
+        children.push_back(std::move(child));
+      }
+    }
+
+    // Keep the best rated children, the first ones on ties
+    std::stable_sort(children.begin(), children.end(),
+                     [](const BeamPosition &a, const BeamPosition &b) {
+                       return a.rating > b.rating;
+                     });
+    if (children.size() > width) {
+      children.erase(children.begin() + width, children.end());
+    }
+    beam.swap(children);
+  }
+  return plan;
+}
+
+/**
+ * @brief A node of the Monte Carlo tree: the field after the moves from the
+ * root and the rollouts which passed it.
+ */
+struct TreeNode {
+  BitboardField field;
+  std::size_t score;  // points of the moves from the root
+  std::size_t depth;  // number of the moves from the root
+  std::size_t parent;
+  BitboardMove move;  // move from the parent
+  std::size_t first_child = 0;
+  std::size_t child_count = 0;
+  bool expanded = false;
+  std::size_t visits = 0;
+  double total = 0;  // sum of the final scores of the rollouts
+
+  TreeNode(const BitboardField &field, std::size_t score, std::size_t depth,
+           std::size_t parent, const BitboardMove &move)
+      : field(field), score(score), depth(depth), parent(parent), move(move) {}
+};
+
+/**
+ * @brief Searches the moves by UCT with random rollouts.
+ *
+ * Each rollout descends the tree by the UCB1 rule on the mean final scores
+ * scaled by the best final score so far, expands the leaf it reaches, plays
+ * random moves from its first child to the end of the game and adds the
+ * final score to the nodes on the way. The best game played is the plan.
+ * An expansion leaves out the children whose field the tree has already.
+ */
+static SearchPlan monte_carlo_search(const BitboardField &field,
+                                     const SearchConfig &config,
+                                     const SearchDeadline &deadline,
+                                     TranspositionTable *table,
+                                     SearchPlan plan) {
+  std::mt19937_64 generator(config.seed);
+  std::vector<TreeNode> tree{TreeNode(field, 0, 0, none, BitboardMove{})};
+  reached_before(table, field, 0, 0);
+  std::vector<BitboardMove> moves;
+  std::vector<BitboardMove> rollout;
+
+  // Returns the child of a node with the highest upper confidence bound
+  auto select_child = [&](const TreeNode &node) {
+    double scale = std::max<double>(plan.score, 1);
+    double log_visits = std::log(static_cast<double>(node.visits));
+    std::size_t best = node.first_child;
+    double best_bound = -1;
+    for (std::size_t k = node.first_child;
+         k < node.first_child + node.child_count; k++) {
+      const TreeNode &child = tree[k];
+      if (child.visits == 0) {
+        return k;
+      }
+      double bound = child.total / child.visits / scale +
+                     UCT_EXPLORATION * std::sqrt(log_visits / child.visits);
+      if (bound > best_bound) {
+        best_bound = bound;
+        best = k;
+      }
+    }
+    return best;
+  };
+
+  for (std::size_t n = 0; n < config.rollouts && !deadline.passed(); n++) {
+    // Descend to a leaf and expand it
+    std::size_t leaf = 0;
+    while (tree[leaf].expanded && tree[leaf].child_count) {
+      leaf = select_child(tree[leaf]);
+    }
+    if (!tree[leaf].expanded) {
+      tree[leaf].field.list_moves(moves);
+      tree[leaf].expanded = true;
+      tree[leaf].first_child = tree.size();
+      for (const auto &move : moves) {
+        TreeNode child(tree[leaf].field, tree[leaf].score + move.points(),
+                       tree[leaf].depth + 1, leaf, move);
+        child.field.make_move(move);
+        if (!reached_before(table, child.field, child.score, child.depth)) {
+          tree.push_back(std::move(child));
+        }
+      }
+      tree[leaf].child_count = tree.size() - tree[leaf].first_child;
+      if (tree[leaf].child_count) {
+        leaf = tree[leaf].first_child;
+      }
+    }
+
+    // Play random moves to the end of the game
+    BitboardField rollout_field = tree[leaf].field;
+    std::size_t score = tree[leaf].score;
+    rollout.clear();
+    while (true) {
+      rollout_field.list_moves(moves);
+      if (moves.empty()) {
+        break;
+      }
+      std::uniform_int_distribution<std::size_t> pick(0, moves.size() - 1);
+      const BitboardMove &move = moves[pick(generator)];
+      rollout_field.make_move(move);
+      score += move.points();
+      rollout.push_back(move);
+    }
+    score = final_score(rollout_field, score);
+
+    if (score > plan.score) {
+      plan.moves.clear();
+      for (std::size_t node = leaf; node != 0; node = tree[node].parent) {
+        plan.moves.push_back(tree[node].move);
+      }
+      std::reverse(plan.moves.begin(), plan.moves.end());
+      plan.moves.insert(plan.moves.end(), rollout.begin(), rollout.end());
+      plan.score = score;
+    }
+
+    for (std::size_t node = leaf; node != none; node = tree[node].parent) {
+      tree[node].visits++;
+      tree[node].total += score;
+    }
+  }
+  return plan;
+}
+
+/**
+ * @brief Bounds the points the moves ahead can score by the numbers of balls
+ * of every colour.
+ *
+ * The balls of a colour score the most when they go in one cluster, and a
+ * colour with one or two balls left can never be removed, so the field can
+ * not be cleared.
+ */
+static std::size_t points_bound(
+    const std::array<std::size_t, NUMBER_OF_COLOURS> &counts) {
+  std::size_t bound = 0;
+  bool clearable = true;
+  for (std::size_t n : counts) {
+    if (n >= 3) {
+      bound += (n - 2) * (n - 2);
+    } else if (n) {
+      clearable = false;
+    }
+  }
+  return clearable ? bound + CLEAR_BONUS : bound;
+}
+
+/**
+ * @brief A move and the bound of the points it leads to.
+ */
+struct RatedMove {
+  std::size_t bound;
+  BitboardMove move;
+};
+
+/**
+ * @brief Finds the best moves of a small field by a depth-first search.
+ *
+ * The search tries the moves by the bound of their points, and stops once
+ * the bound of the next move is no better than the best move so far, so the
+ * value it finds for every field it finishes is exact and is memoised by
+ * the Zobrist hash of the field, unless the memo has no size.
+ */
+class EndgameSolver {
+ private:
+  std::unique_ptr<TranspositionTable> memo_;
+  const SearchDeadline &deadline_;
+  bool out_of_time_ = false;
+  std::vector<BitboardMove> listed_;
+  std::vector<std::vector<RatedMove>> moves_;  // moves of every depth
+
+  std::size_t solve(BitboardField &field, std::size_t depth);
+
+ public:
+  // A move removes at least 3 balls, which bounds the depth
+  EndgameSolver(std::size_t memo_bits, const SearchDeadline &deadline)
+      : memo_(memo_bits ? std::make_unique<TranspositionTable>(memo_bits)
+                        : nullptr),
+        deadline_(deadline),
+        moves_(FIELD_HEIGHT * FIELD_WIDTH / 3 + 1) {}
+
+  bool best_moves(BitboardField field, std::vector<BitboardMove> &moves,
+                  std::size_t &value);
+};
+
+/**
+ * @brief Returns the best points the moves ahead of the field can score,
+ * counting the clear bonus, or 0 once the time has run out.
+ */
+std::size_t EndgameSolver::solve(BitboardField &field, std::size_t depth) {
+  if (deadline_.passed()) {
+    out_of_time_ = true;
+  }
+  if (out_of_time_) {
+    return 0;
+  }
+  TranspositionEntry entry;
+  if (memo_ && memo_->probe(field.hash(), entry)) {
+    return entry.score;
+  }
+
+  std::array<std::size_t, NUMBER_OF_COLOURS> counts;
+  for (std::size_t colour = 0; colour < NUMBER_OF_COLOURS; colour++) {
+    counts[colour] = field.count_balls(colour);
+  }
+  std::vector<RatedMove> &rated = moves_[depth];
+  rated.clear();
+  field.list_moves(listed_);
+  for (const auto &move : listed_) {
+    counts[move.colour] -= move.size;
+    rated.push_back({move.points() + points_bound(counts), move});
+    counts[move.colour] += move.size;
+  }
+  std::stable_sort(rated.begin(), rated.end(),
+                   [](const RatedMove &a, const RatedMove &b) {
+                     return a.bound > b.bound;
+                   });
+
+  std::size_t best = field.count_balls_on_field() == 0 ? CLEAR_BONUS : 0;
+  for (std::size_t k = 0; k < rated.size() && rated[k].bound > best; k++) {
+    const BitboardMove &move = rated[k].move;
+    MoveUndo undo;
+    field.apply_move(move, undo);
+    best = std::max(best, move.points() + solve(field, depth + 1));
+    field.undo_move(undo);
+  }
+  if (out_of_time_) {
+    return 0;
+  }
+
+  if (memo_) {
+    memo_->store(field.hash(), {static_cast<std::uint32_t>(best), 0});
+  }
+  return best;
+}
+
+/**
+ * @brief Finds the best moves of a field.
+ *
+ * @param moves Receives the moves, in order.
+ * @param value Receives their points, counting the clear bonus.
+ * @return False if the time ran out first.
+ */
+bool EndgameSolver::best_moves(BitboardField field,
+                               std::vector<BitboardMove> &moves,
+                               std::size_t &value) {
+  value = solve(field, 0);
+
+  // Follow the moves which keep the value
+  moves.clear();
+  std::vector<BitboardMove> candidates;
+  for (std::size_t rest = value; !out_of_time_;) {
+    field.list_moves(candidates);
+    bool found = false;
+    for (const auto &move : candidates) {
+      BitboardField child = field;
+      child.make_move(move);
+      if (move.points() + solve(child, 0) == rest) {
+        moves.push_back(move);
+        rest -= move.points();
+        field = child;
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      break;
+    }
+  }
+  return !out_of_time_;
+}
+
+/**
+ * @brief Lets the exact solver replace the end of the plan.
+ *
+ * The solver starts from the last field of the plan and goes back along it
+ * while the fields have fewer balls than the threshold and the time lasts.
+ * The best moves from a field score at least as much as the plan from it,
+ * and the gain can only grow going back, so the earliest field solved gives
+ * the best plan.
+ */
+static SearchPlan solve_endgame(const BitboardField &field,
+                                const SearchConfig &config, SearchPlan plan) {
+  // The fields along the plan and the points of the moves before them
+  std::vector<BitboardField> fields{field};
+  std::vector<std::size_t> scores{0};
+  for (const auto &move : plan.moves) {
+    fields.push_back(fields.back());
+    fields.back().make_move(move);
+    scores.push_back(scores.back() + move.points());
+  }
+
+  SearchDeadline deadline(config.endgame_time_budget);
+  EndgameSolver solver(config.transposition_bits, deadline);
+  std::vector<BitboardMove> moves;
+  SearchPlan best = plan;
+  for (std::size_t k = plan.moves.size(); k-- > 0;) {
+    std::size_t value;
+    if (fields[k].count_balls_on_field() >= config.endgame_threshold ||
+        !solver.best_moves(fields[k], moves, value)) {
+      break;
+    }
+    if (scores[k] + value > best.score) {
+      best.moves.assign(plan.moves.begin(), plan.moves.begin() + k);
+      best.moves.insert(best.moves.end(), moves.begin(), moves.end());
+      best.score = scores[k] + value;
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Plans the moves of a game by the strategy of the config.
+ *
+ * @param field The field the game starts on.
+ * @return The moves to make, in order.
+ * @throws std::invalid_argument If the transposition tables are too large.
+ */
+std::vector<BitboardMove> plan_moves(const BitboardField &field,
+                                     const SearchConfig &config) {
+  if (config.transposition_bits > MAXIMUM_TRANSPOSITION_BITS) {
+    throw std::invalid_argument("Too many transposition bits");
+  }
+  SearchDeadline deadline(config.time_budget);
+  std::unique_ptr<TranspositionTable> table;
+  if (config.transposition_bits && config.strategy != SearchStrategy::Greedy) {
+    table = std::make_unique<TranspositionTable>(config.transposition_bits);
+  }
+
+  // The greedy game is the plan to beat
+  SearchPlan plan;
+  plan.score = complete_greedily(field, 0, &plan.moves);
+
+  switch (config.strategy) {
+    case SearchStrategy::Greedy:
+      break;
+    case SearchStrategy::Beam:
+      plan = beam_search(field, config, deadline, table.get(), std::move(plan));
+      break;
+    case SearchStrategy::MonteCarlo:
+      plan = monte_carlo_search(field, config, deadline, table.get(),
+                                std::move(plan));
+      break;
+  }
+  if (config.endgame_threshold) {
+    plan = solve_endgame(field, config, std::move(plan));
+  }
+  return plan.moves;
+}
+
+}  // namespace RGB_Game
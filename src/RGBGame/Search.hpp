@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bitboard.hpp"
+
+// Points for a field cleared of all balls
+#define CLEAR_BONUS 1000
+
+// Largest size of the transposition tables, as a power of 2; a slot takes 16
+// bytes, so the largest table takes 4 GiB
+#define MAXIMUM_TRANSPOSITION_BITS 28
+
+namespace RGB_Game {
+
+/**
+ * @brief The ways a game can choose its moves.
+ *
+ * Greedy takes the largest cluster, as RGB_Game does. Beam keeps the
+ * beam_width best positions of every move number, rated by the final score
+ * of their greedy completion. MonteCarlo grows a UCT tree with random
+ * rollouts.
+ */
+enum class SearchStrategy { Greedy, Beam, MonteCarlo };
+
+/**
+ * @brief Runtime parameters of the move search.
+ *
+ * The lookahead strategies play the best sequence of moves they found,
+ * counting the clear bonus, and never less than the greedy one. They stop
+ * after time_budget seconds per game, or never if it is 0; the Monte Carlo
+ * search also stops after `rollouts` rollouts, and its random choices repeat
+ * for the same seed. Both skip the fields they reached before with as many
+ * points, found in a transposition table of 2^transposition_bits entries,
+ * or in none if it is 0; it may be at most MAXIMUM_TRANSPOSITION_BITS.
+ *
+ * Once fewer than endgame_threshold balls are left, the moves of any
+ * strategy give way to the best ones an exact solver finds within
+ * endgame_time_budget seconds per game; a threshold of 0 turns it off. The
+ * solver memoises the fields it solved in a table of the same size.
+ */
+struct SearchConfig {
+  SearchStrategy strategy = SearchStrategy::Greedy;
+  std::size_t beam_width = 16;
+  std::size_t rollouts = 1000;
+  double time_budget = 1;
+  std::uint64_t seed = 0;
+  std::size_t transposition_bits = 16;
+  std::size_t endgame_threshold = 0;
+  double endgame_time_budget = 0.1;
+};
+
+std::vector<BitboardMove> plan_moves(const BitboardField &field,
+                                     const SearchConfig &config);
+
+}  // namespace RGB_Game
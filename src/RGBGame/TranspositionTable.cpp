@@ -0,0 +1,50 @@
+#include "TranspositionTable.hpp"
+
+namespace RGB_Game {
+
+// Marks the data of a slot which holds an entry
+static const std::uint64_t occupied = std::uint64_t(1) << 63;
+
+/**
+ * @brief Constructs an empty table of 2^size_bits slots.
+ */
+TranspositionTable::TranspositionTable(std::size_t size_bits)
+    : slots_(new Slot[std::size_t(1) << size_bits]),
+      mask_((std::size_t(1) << size_bits) - 1) {}
+
+/**
+ * @brief Looks up the entry of a position.
+ *
+ * @param key The Zobrist hash of the position.
+ * @param entry Receives the entry, if there is one.
+ * @return False if the table holds no entry for the position.
+ */
+bool TranspositionTable::probe(std::uint64_t key,
+                               TranspositionEntry &entry) const {
+  const Slot &slot = slots_[key & mask_];
+  std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+  std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+  if (!(data & occupied) || (check ^ data) != key) {
+    return false;
+  }
+  entry.score = static_cast<std::uint32_t>(data);
+  entry.depth = static_cast<std::uint32_t>(data >> 32) & ~(occupied >> 32);
+  return true;
+}
+
+/**
+ * @brief Stores the entry of a position over the slot it hashes to.
+ *
+ * @param key The Zobrist hash of the position.
+ * @param entry The entry; its depth must fit in 31 bits.
+ */
+void TranspositionTable::store(std::uint64_t key,
+                               const TranspositionEntry &entry) {
+  std::uint64_t data =
+      occupied | std::uint64_t(entry.depth) << 32 | entry.score;
+  Slot &slot = slots_[key & mask_];
+  slot.check.store(key ^ data, std::memory_order_relaxed);
+  slot.data.store(data, std::memory_order_relaxed);
+}
+
+}  // namespace RGB_Game
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace RGB_Game {
+
+/**
+ * @brief What a search has learnt about a position.
+ */
+struct TranspositionEntry {
+  std::uint32_t score = 0;  // best points of the moves which reached it
+  std::uint32_t depth = 0;  // number of those moves
+};
+
+/**
+ * @brief Fixed-size hash table of positions, keyed by their Zobrist hash.
+ *
+ * A slot keeps the entry packed in one word and the key XORed with it in
+ * another, so the threads sharing the table need no lock: a slot torn by
+ * two concurrent stores no longer matches either key and reads as a miss.
+ * A store replaces the entry of whichever position held the slot.
+ */
+class TranspositionTable {
+ private:
+  struct Slot {
+    std::atomic<std::uint64_t> check{0};
+    std::atomic<std::uint64_t> data{0};
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_;
+
+ public:
+  explicit TranspositionTable(std::size_t size_bits);
+
+  TranspositionTable(const TranspositionTable &) = delete;
+  TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+  bool probe(std::uint64_t key, TranspositionEntry &entry) const;
+  void store(std::uint64_t key, const TranspositionEntry &entry);
+};
+
+}  // namespace RGB_Game
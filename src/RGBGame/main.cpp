@@ -1,11 +1,96 @@
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+
+#include "BatchGame.hpp"
 #include "RGBGame.hpp"
+#include "Search.hpp"
+
+/**
+ * @brief Reads a non-negative decimal number from the whole argument.
+ */
+static bool parse_count(const char *argument, std::size_t &count) {
+  if (!std::isdigit(static_cast<unsigned char>(*argument))) {
+    return false;
+  }
+  char *end = nullptr;
+  count = std::strtoul(argument, &end, 10);
+  return *end == '\0';
+}
+
+/**
+ * @brief Reads a finite non-negative number of seconds from the whole
+ * argument.
+ */
+static bool parse_seconds(const char *argument, double &seconds) {
+  if (!std::isdigit(static_cast<unsigned char>(*argument))) {
+    return false;
+  }
+  char *end = nullptr;
+  seconds = std::strtod(argument, &end);
+  return *end == '\0' && std::isfinite(seconds);
+}
+
+/**
+ * @brief Entry point for the RGBGame program.
+ *
+ * Reads the games from the standard input and prints their logs to the
+ * standard output. The moves are greedy, or searched by a beam of the given
+ * width with --beam <width>, or by Monte Carlo tree search with the given
+ * number of rollouts with --mcts <rollouts>; --time <seconds> bounds the
+ * search of every game. --endgame <balls> solves the game exactly once
+ * fewer balls are left. The fields have the default size unless given by
+ * --height <rows> and --width <columns>. --simulate <games> plays the given
+ * number of greedy games on random fields instead and reports their speed.
+ */
+int main(int argc, char **argv) {
+  RGB_Game::SearchConfig config;
+  std::size_t height = FIELD_HEIGHT, width = FIELD_WIDTH;
+  std::size_t simulated_games = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--beam") == 0 && i + 1 < argc &&
+        parse_count(argv[i + 1], config.beam_width)) {
+      config.strategy = RGB_Game::SearchStrategy::Beam;
+      i++;
+    } else if (std::strcmp(argv[i], "--mcts") == 0 && i + 1 < argc &&
+               parse_count(argv[i + 1], config.rollouts)) {
+      config.strategy = RGB_Game::SearchStrategy::MonteCarlo;
+      i++;
+    } else if (std::strcmp(argv[i], "--time") == 0 && i + 1 < argc &&
+               parse_seconds(argv[i + 1], config.time_budget)) {
+      i++;
+    } else if (std::strcmp(argv[i], "--endgame") == 0 && i + 1 < argc &&
+               parse_count(argv[i + 1], config.endgame_threshold)) {
+      i++;
+    } else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc &&
+               parse_count(argv[i + 1], height)) {
+      i++;
+    } else if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc &&
+               parse_count(argv[i + 1], width)) {
+      i++;
+    } else if (std::strcmp(argv[i], "--simulate") == 0 && i + 1 < argc &&
+               parse_count(argv[i + 1], simulated_games)) {
+      i++;
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--beam <width> | --mcts <rollouts>] [--time <seconds>]"
+                << " [--endgame <balls>] [--height <rows>] [--width <columns>]"
+                << " [--simulate <games>]" << std::endl;
+      return 1;
+    }
+  }
 
-int main() {
-  try{
-  std::cout << RGB_Game::handle_rgb_game(std::cin);
+  try {
+    if (simulated_games) {
+      std::cout << RGB_Game::handle_batch_simulation(simulated_games,
+                                                     config.seed);
+      return 0;
+    }
+    std::cout << RGB_Game::handle_rgb_game(std::cin, height, width, config);
   } catch (const std::exception &e) {
     std::cerr << e.what() << std::endl;
   }
   return 0;
-}
\ No newline at end of file
+}
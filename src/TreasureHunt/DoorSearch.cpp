@@ -0,0 +1,171 @@
+#include "DoorSearch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ranges>
+#include <utility>
+
+namespace Treasure_Hunt {
+
+/**
+ * Finds the doors leading out of the region around the treasure point.
+ *
+ * @param wall_set The walls of the field.
+ * @param field The field box.
+ * @param polygon_ids The ids of the walls that limit the region, from the
+ * ray casting.
+ * @param node The current position.
+ * @param next_nodes Receives the positions behind the doors.
+ * @return The number of intersections computed.
+ *
+ * A wall is a door if its center lies between the intersections with the
+ * other walls of the region that bound it; the position behind the door is
+ * the center moved slightly away from the treasure point.
+ */
+std::size_t find_doors(const WallSet &wall_set, const Box &field,
+                       const std::vector<std::size_t> &polygon_ids,
+                       const TraverseNode &node,
+                       std::vector<TraverseNode> &next_nodes) {
+  const auto &entering_wall = node.entering_wall;
+  const auto &treasure_point = node.treasure_point;
+
+  // Define the epsilon value for floating point comparisons
+  double epsilon = 1e-8;
+
+  // Get the walls that limit the point
+  std::vector<Wall> polygon;
+  polygon.reserve(polygon_ids.size());
+  for (auto id : polygon_ids) {
+    polygon.push_back(wall_set.wall(id));
+  }
+  std::vector<double> px(polygon.size()), py(polygon.size());
+  std::vector<unsigned char> kept(polygon.size());
+
+  // Find all possible intersections between the walls that limit the point,
+  // exactly if the coordinates are integers, as pairs of the index of the
+  // wall in the polygon and the point. The intersection of two lines does
+  // not depend on their order, so every pair of walls is intersected once
+  std::vector<std::pair<std::size_t, Point>> wall_intersections;
+  std::size_t intersections_computed = 0;
+  for (std::size_t i = 0; i < polygon.size(); i++) {
+    std::size_t count = polygon.size() - i - 1;
+    intersections_computed += count;
+    wall_set.intersect_walls(polygon_ids[i], polygon_ids.data() + i + 1,
+                             count, field, px.data(),
+                             py.data(), kept.data());
+    for (std::size_t k = 0; k < count; k++) {
+      if (!kept[k]) {
+        continue;
+      }
+      Point intersection(px[k], py[k]);
+      wall_intersections.emplace_back(i, intersection);
+      wall_intersections.emplace_back(i + k + 1, intersection);
+    }
+  }
+
+  // Group the intersections by wall and drop the duplicates. The points which
+  // are not numbers never equal anything and go last
+  auto is_nan = [](const Point &point) {
+    return std::isnan(point.x()) || std::isnan(point.y());
+  };
+  std::sort(wall_intersections.begin(), wall_intersections.end(),
+            [&](const auto &lhs, const auto &rhs) {
+              if (lhs.first != rhs.first) {
+                return lhs.first < rhs.first;
+              }
+              bool lhs_nan = is_nan(lhs.second), rhs_nan = is_nan(rhs.second);
+              if (lhs_nan || rhs_nan) {
+                return !lhs_nan;
+              }
+              return std::pair(lhs.second.x(), lhs.second.y()) <
+                     std::pair(rhs.second.x(), rhs.second.y());
+            });
+  wall_intersections.erase(
+      std::unique(wall_intersections.begin(), wall_intersections.end()),
+      wall_intersections.end());
+
+  // Find the next valid move by checking if the center of the wall is inside
+  // the intersection limits
+  for (auto group = wall_intersections.begin();
+       group != wall_intersections.end();) {
+    auto group_end = std::find_if(group, wall_intersections.end(),
+                                  [&](const auto &wall_intersection) {
+                                    return wall_intersection.first !=
+                                           group->first;
+                                  });
+    auto wall = polygon[group->first];
+    auto intersections = std::ranges::subrange(group, group_end);
+    group = group_end;
+    if (wall == entering_wall && wall != Wall(-1, -1, -1, -1)) {
+      continue;
+    }
+    std::vector<Point> bounds;
+
+    for (const auto &[_, intersection] : intersections) {
+      auto min_x = std::min(intersection.x(), treasure_point.x());
+      auto max_x = std::max(intersection.x(), treasure_point.x());
+      auto min_y = std::min(intersection.y(), treasure_point.y());
+      auto max_y = std::max(intersection.y(), treasure_point.y());
+      bool bound_found = true;
+
+      Wall temp_wall(treasure_point.x(), treasure_point.y(), intersection.x(),
+                     intersection.y());
+      wall_set.intersect_line(LineCoefficients(temp_wall), polygon_ids.data(),
+                              polygon_ids.size(), px.data(), py.data());
+      intersections_computed += polygon_ids.size();
+      for (std::size_t k = 0; k < polygon.size(); k++) {
+        const auto &checking_wall = polygon[k];
+        if (checking_wall == wall || checking_wall == entering_wall) {
+          continue;
+        }
+        Point intersection_point(px[k], py[k]);
+
+        // Check if the intersection point is inside the bounds of the walls
+        bool inside_bound_x = intersection_point.x() - min_x >= epsilon &&
+                              max_x - intersection_point.x() >= epsilon;
+        bool inside_bound_y = intersection_point.y() - min_y >= epsilon &&
+                              max_y - intersection_point.y() >= epsilon;
+        if (inside_bound_x && inside_bound_y) {
+          bound_found = false;
+          break;
+        }
+      }
+
+      if (bound_found) {
+        bounds.push_back(intersection);
+      }
+    }
+
+    if (bounds.empty()) {
+      continue;
+    }
+
+    // Find the bounds of the intersection limits
+    auto comp = [](const Point &p1, const Point &p2) {
+      return p1.get_distance_with_point(Point(0, 0)) <
+             p2.get_distance_with_point(Point(0, 0));
+    };
+    auto first_bound = *std::min_element(bounds.begin(), bounds.end(), comp);
+    auto second_bound = *std::max_element(bounds.begin(), bounds.end(), comp);
+
+    // Check if the center of the wall is inside the bounds
+    auto center = wall.get_center();
+    if (center.x() <= second_bound.x() && center.x() >= first_bound.x() &&
+        center.y() <= second_bound.y() && center.y() >= first_bound.y()) {
+      double dx = (center.x() - treasure_point.x());
+      double dy = (center.y() - treasure_point.y());
+      double dist = std::sqrt(dx * dx + dy * dy);
+      dx /= (dist);
+      dy /= (dist);
+      dx /= (dist);
+      dy /= (dist);
+
+      Point new_treasure_point = Point(center.x() + dx, center.y() + dy);
+      next_nodes.push_back(TraverseNode{wall, new_treasure_point});
+    }
+  }
+
+  return intersections_computed;
+}
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "TreasureHunt.hpp"
+#include "WallSet.hpp"
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief A position reached by the traversal: the point just behind the door
+ * which was passed last, and the wall of that door.
+ */
+struct TraverseNode {
+  Wall entering_wall;
+  Point treasure_point;
+};
+
+std::size_t find_doors(const WallSet &wall_set, const Box &field,
+                       const std::vector<std::size_t> &polygon_ids,
+                       const TraverseNode &node,
+                       std::vector<TraverseNode> &next_nodes);
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,144 @@
+#include "RayCastContext.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Smallest number of walls for which ray casting uses the spatial index
+#define GRID_MINIMUM_WALLS 64
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Prepares the casting of the rays of a field.
+ *
+ * @param walls The walls; the context keeps a reference to them.
+ * @param config The field parameters.
+ * @param grid The spatial index of the walls, if there is one; it is only
+ * used with enough walls to pay off.
+ */
+RayCastContext::RayCastContext(const WallSet &walls, const FieldConfig &config,
+                               const WallGrid *grid)
+    : walls_(walls),
+      field_(config.field),
+      grid_(walls.size() >= GRID_MINIMUM_WALLS ? grid : nullptr) {
+  double ray_length = config.ray_length();
+  ray_dx_.reserve(config.ray_count);
+  ray_dy_.reserve(config.ray_count);
+  for (std::size_t step = 0; step < config.ray_count; step++) {
+    double phi = step * config.phi_step;
+    ray_dx_.push_back(ray_length * std::cos(phi));
+    ray_dy_.push_back(ray_length * std::sin(phi));
+  }
+  nearest_walls_.reserve(config.ray_count);
+  ray_hits_.resize(config.ray_count);
+
+  // A ray query may end up with every wall as a candidate
+  if (grid_) {
+    query_.ids.reserve(walls.size());
+    query_.px.reserve(walls.size());
+    query_.py.reserve(walls.size());
+    query_.kept.reserve(walls.size());
+    query_.stamp.assign(walls.size(), 0);
+    query_.order.reserve(walls.size());
+  }
+}
+
+/**
+ * @brief Casts the rays from a point and finds the nearest wall of each.
+ *
+ * The intersections of a ray are visited by increasing wall id. The nearest
+ * one is the first with the smallest distance, and its wall is the last wall
+ * through exactly the same point. If the first intersection kept is not a
+ * number, the ray reports the zero wall, since no distance compares less
+ * than it.
+ */
+const std::vector<std::size_t> &RayCastContext::cast(
+    const Point &casting_point) {
+  double x0 = casting_point.x(), y0 = casting_point.y();
+  nearest_walls_.clear();
+  counters_.casts++;
+  counters_.rays += ray_dx_.size();
+
+  for (std::size_t r = 0; r < ray_dx_.size(); r++) {
+    Wall ray = this->ray(r, casting_point);
+
+    // Intersect the ray with the walls around it, or with every wall
+    const std::size_t *ids = nullptr;
+    const std::size_t *order = nullptr;
+    std::size_t count = walls_.size();
+    const double *px, *py;
+    const unsigned char *kept;
+    if (grid_ && grid_->cast_ray(ray, query_)) {
+      ids = query_.ids.data();
+      order = query_.order.data();
+      count = query_.order.size();
+      px = query_.px.data();
+      py = query_.py.data();
+      kept = query_.kept.data();
+    } else {
+      px_.resize(walls_.size());
+      py_.resize(walls_.size());
+      kept_.resize(walls_.size());
+      walls_.cast_ray(ray, field_, px_.data(), py_.data(), kept_.data());
+      px = px_.data();
+      py = py_.data();
+      kept = kept_.data();
+    }
+    counters_.intersections += count;
+
+    // Find the nearest intersection and the last wall through it
+    bool found = false;
+    std::size_t nearest = 0, first_wall = 0, nearest_wall = 0;
+    double nearest_distance = 0;
+    for (std::size_t i = 0; i < count; i++) {
+      std::size_t k = order ? order[i] : i;
+      if (!kept[k]) {
+        continue;
+      }
+      double a = py[k] - y0;
+      double b = px[k] - x0;
+      double distance = std::sqrt(a * a + b * b);
+      if (!found || distance < nearest_distance) {
+        found = true;
+        nearest = k;
+        first_wall = nearest_wall = ids ? ids[k] : k;
+        nearest_distance = distance;
+      } else if (px[k] == px[nearest] && py[k] == py[nearest]) {
+        nearest_wall = ids ? ids[k] : k;
+      }
+    }
+
+    ray_hits_[r] = RayHit{found ? px[nearest] : 0, found ? py[nearest] : 0,
+                          first_wall, nearest_wall, found};
+    if (found) {
+      bool is_number = !std::isnan(px[nearest]) && !std::isnan(py[nearest]);
+      nearest_walls_.push_back(is_number ? nearest_wall : walls_.size());
+    }
+  }
+
+  std::sort(nearest_walls_.begin(), nearest_walls_.end());
+  nearest_walls_.erase(
+      std::unique(nearest_walls_.begin(), nearest_walls_.end()),
+      nearest_walls_.end());
+  return nearest_walls_;
+}
+
+std::size_t RayCastContext::ray_count() const { return ray_dx_.size(); }
+
+/**
+ * @brief Returns the ray with the given index cast from a point.
+ */
+Wall RayCastContext::ray(std::size_t r, const Point &casting_point) const {
+  return Wall(casting_point.x(), casting_point.y(),
+              casting_point.x() + ray_dx_[r], casting_point.y() + ray_dy_[r]);
+}
+
+const std::vector<RayCastContext::RayHit> &RayCastContext::ray_hits() const {
+  return ray_hits_;
+}
+
+const RayCastContext::Counters &RayCastContext::counters() const {
+  return counters_;
+}
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "TreasureHunt.hpp"
+#include "WallGrid.hpp"
+#include "WallSet.hpp"
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Reusable state of ray_casting.
+ *
+ * The directions of the rays are computed once, and every buffer the casting
+ * needs is kept between the calls, so casting from a new point does not
+ * allocate once the buffers have grown to their working size. The nearest
+ * wall of every ray is tracked by its id in the WallSet rather than by
+ * hashing the intersection points.
+ */
+class RayCastContext {
+ public:
+  /**
+   * @brief The nearest intersection kept for one ray, if it has any, with the
+   * first wall through it and the last one, which the ray reports.
+   */
+  struct RayHit {
+    double x, y;
+    std::size_t wall;
+    std::size_t last_wall;
+    bool found;
+  };
+
+  /**
+   * @brief Running totals of the work done by the casts.
+   */
+  struct Counters {
+    std::size_t casts = 0;
+    std::size_t rays = 0;
+    std::size_t intersections = 0;
+  };
+
+ private:
+  const WallSet &walls_;
+  Box field_;
+  const WallGrid *grid_;
+
+  // Offsets from the casting point to the ends of the rays
+  std::vector<double> ray_dx_, ray_dy_;
+
+  // Intersections of one ray with every wall, for the full scans
+  std::vector<double> px_, py_;
+  std::vector<unsigned char> kept_;
+  WallGrid::Query query_;
+
+  std::vector<std::size_t> nearest_walls_;
+  std::vector<RayHit> ray_hits_;
+
+  Counters counters_;
+
+ public:
+  RayCastContext(const WallSet &walls, const FieldConfig &config,
+                 const WallGrid *grid = nullptr);
+
+  /**
+   * @brief Casts the rays from a point and finds the nearest wall of each.
+   *
+   * @param casting_point The point from which to cast the rays.
+   * @return The ids of the nearest walls, sorted and without duplicates; the
+   * id size() of the WallSet stands for the zero wall reported for degenerate
+   * rays. The result is valid until the next call.
+   */
+  const std::vector<std::size_t> &cast(const Point &casting_point);
+
+  std::size_t ray_count() const;
+  Wall ray(std::size_t r, const Point &casting_point) const;
+
+  /**
+   * @brief Returns the nearest intersection of every ray of the last cast.
+   */
+  const std::vector<RayHit> &ray_hits() const;
+
+  const Counters &counters() const;
+};
+
+}  // namespace Treasure_Hunt
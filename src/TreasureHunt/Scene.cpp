@@ -0,0 +1,308 @@
+#include "Scene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
+// Number of walls added since the grid was built beyond which it is rebuilt,
+// as a fraction of the walls it was built with
+#define GRID_REBUILD_DIVISOR 4
+#define GRID_REBUILD_MINIMUM 64
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Creates a field with its outer walls only.
+ *
+ * @param config The field parameters; the searches of the scene run on one
+ * thread.
+ */
+Scene::Scene(const FieldConfig &config)
+    : config_(config), outer_walls_(config.outer_walls()), walls_() {
+  for (const auto &wall : outer_walls_) {
+    walls_.add(wall);
+  }
+  wall_positions_.resize(walls_.size() + 1);
+}
+
+/**
+ * @brief Adds a wall to the field.
+ *
+ * @param wall The wall.
+ * @return The id of the wall, used to remove it.
+ *
+ * The new wall is intersected with the rays of every cached position it can
+ * reach. A position changes if the wall gives a ray its first hit, a nearer
+ * hit, or a hit at exactly the nearest point, since the last wall through
+ * that point is the one reported.
+ */
+std::size_t Scene::add_wall(const Wall &wall) {
+  if (wall_count_ >= config_.maximum_walls) {
+    throw std::invalid_argument("Too many walls");
+  }
+
+  // The new wall takes the id of the zero wall, so the positions which report
+  // the zero wall change
+  std::size_t id = walls_.add(wall);
+  wall_count_++;
+  invalidate_positions(id);
+  wall_positions_.resize(walls_.size() + 1);
+  if (!ray_cast_) {
+    return id;
+  }
+  grid_->add(id);
+
+  double ray_length = config_.ray_length();
+  for (auto &position : positions_) {
+    if (!position.valid) {
+      continue;
+    }
+    const auto &point = position.node.treasure_point;
+    if (wall.get_distance_with_point(point) > ray_length * (1 + 1e-9)) {
+      continue;
+    }
+
+    for (std::size_t r = 0; r < ray_cast_->ray_count(); r++) {
+      double x, y;
+      unsigned char kept;
+      walls_.cast_ray(ray_cast_->ray(r, point), config_.field, &id, 1, &x, &y,
+                      &kept);
+      if (!kept) {
+        continue;
+      }
+
+      const auto &hit = position.ray_hits[r];
+      double distance = point.get_distance_with_point(Point(x, y));
+      double nearest = point.get_distance_with_point(Point(hit.x, hit.y));
+      if (!hit.found || distance < nearest || (x == hit.x && y == hit.y)) {
+        position.valid = false;
+        break;
+      }
+    }
+  }
+
+  return id;
+}
+
+/**
+ * @brief Removes a wall added to the field.
+ *
+ * @param id The id returned by add_wall.
+ *
+ * Only the positions for which the wall was the nearest wall of a ray, or
+ * the first wall through the nearest point, can change.
+ */
+void Scene::remove_wall(std::size_t id) {
+  if (id >= walls_.size() || walls_.removed(id)) {
+    throw std::out_of_range("No wall with the given id");
+  }
+  if (id < outer_walls_.size()) {
+    throw std::invalid_argument("The outer walls cannot be removed");
+  }
+
+  walls_.remove(id);
+  wall_count_--;
+  invalidate_positions(id);
+}
+
+/**
+ * @brief Returns the walls of the field by id, the outer walls first.
+ */
+std::vector<Wall> Scene::walls() const {
+  std::vector<Wall> walls;
+  for (std::size_t id = 0; id < walls_.size(); id++) {
+    if (!walls_.removed(id)) {
+      walls.push_back(walls_.wall(id));
+    }
+  }
+  return walls;
+}
+
+/**
+ * @brief Marks the positions which depend on the wall with the given id as
+ * invalid.
+ */
+void Scene::invalidate_positions(std::size_t id) {
+  for (auto position : wall_positions_[id]) {
+    positions_[position].valid = false;
+  }
+  wall_positions_[id].clear();
+}
+
+/**
+ * @brief Builds the grid again once enough walls have been added since it
+ * was built, since the rays test every such wall.
+ */
+void Scene::prepare_ray_cast() {
+  std::size_t added = walls_.size() - grid_size_;
+  if (ray_cast_ && added <= std::max<std::size_t>(
+                                GRID_REBUILD_MINIMUM,
+                                grid_size_ / GRID_REBUILD_DIVISOR)) {
+    return;
+  }
+
+  grid_.emplace(walls_, config_.field);
+  ray_cast_.emplace(walls_, config_, &*grid_);
+  grid_size_ = walls_.size();
+}
+
+/**
+ * @brief Finds the cached position for a node, casting its rays again if it
+ * is new or has been invalidated.
+ *
+ * @return The index of the position.
+ */
+std::size_t Scene::position(const TraverseNode &node) {
+  const auto &point = node.treasure_point;
+  const auto &wall = node.entering_wall;
+  PositionKey key(point.x(), point.y(), wall.x1(), wall.y1(), wall.x2(),
+                  wall.y2());
+  auto [it, inserted] = position_ids_.try_emplace(key, positions_.size());
+  if (inserted) {
+    positions_.emplace_back();
+    positions_.back().node = node;
+  }
+
+  std::size_t id = it->second;
+  auto &position = positions_[id];
+  if (position.valid) {
+    return id;
+  }
+
+  position.polygon_ids = ray_cast_->cast(point);
+  position.ray_hits = ray_cast_->ray_hits();
+  position.valid = true;
+  position.doors_valid = false;
+
+  // Register the position with the walls whose removal can change it
+  for (auto wall_id : position.polygon_ids) {
+    wall_positions_[wall_id].push_back(id);
+  }
+  for (const auto &hit : position.ray_hits) {
+    if (hit.found) {
+      wall_positions_[hit.wall].push_back(id);
+    }
+  }
+  return id;
+}
+
+/**
+ * @brief Returns the positions behind the doors of a valid position.
+ */
+const std::vector<TraverseNode> &Scene::doors(std::size_t id) {
+  auto &position = positions_[id];
+  if (!position.doors_valid) {
+    position.doors.clear();
+    find_doors(walls_, config_.field, position.polygon_ids, position.node,
+               position.doors);
+    position.doors_valid = true;
+  }
+  return position.doors;
+}
+
+bool Scene::touches_field_boundary(
+    const std::vector<std::size_t> &polygon_ids) const {
+  for (auto id : polygon_ids) {
+    Wall wall = walls_.wall(id);
+    if (std::find(outer_walls_.begin(), outer_walls_.end(), wall) !=
+        outer_walls_.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Builds the signature of a region from the coordinates of its walls,
+ * which do not change with the ids.
+ */
+Scene::RegionSignature Scene::region_signature(
+    const std::vector<std::size_t> &polygon_ids) const {
+  RegionSignature signature;
+  signature.reserve(polygon_ids.size());
+  for (auto id : polygon_ids) {
+    Wall wall = walls_.wall(id);
+    signature.emplace_back(wall.x1(), wall.y1(), wall.x2(), wall.y2());
+  }
+  std::sort(signature.begin(), signature.end());
+  signature.erase(std::unique(signature.begin(), signature.end()),
+                  signature.end());
+  return signature;
+}
+
+/**
+ * @brief Calculates the number of doors to the treasure point.
+ *
+ * @param treasure_point The treasure point.
+ * @return The number of doors, or nothing if the treasure cannot be reached.
+ *
+ * The search is the breadth-first search of calc_number_of_doors, with the
+ * ray casting and the doors of every position taken from the cache. It cuts
+ * the same regions: the ones entered again from the same parent region with
+ * more doors than the first time.
+ */
+std::optional<std::size_t> Scene::number_of_doors(
+    const Point &treasure_point) {
+  auto key = std::pair(treasure_point.x(), treasure_point.y());
+  if (auto it = answers_.find(key); it != answers_.end()) {
+    const auto &positions = it->second.positions;
+    if (std::all_of(positions.begin(), positions.end(),
+                    [&](std::size_t id) { return positions_[id].valid; })) {
+      return it->second.number_of_doors;
+    }
+  }
+
+  prepare_ray_cast();
+
+  Answer answer;
+  std::map<std::pair<RegionSignature, RegionSignature>, std::size_t> explored;
+  std::vector<TraverseNode> level = {
+      TraverseNode{Wall(-1, -1, -1, -1), treasure_point}};
+  std::vector<std::size_t> parents = {0};
+  std::vector<RegionSignature> parent_signatures;
+  std::vector<TraverseNode> next_level;
+  std::vector<std::size_t> next_parents;
+  std::vector<RegionSignature> signatures;
+
+  for (std::size_t number_of_walls = 0;
+       !level.empty() && !answer.number_of_doors; number_of_walls++) {
+    next_level.clear();
+    next_parents.clear();
+    signatures.clear();
+    for (std::size_t i = 0; i < level.size(); i++) {
+      std::size_t id = position(level[i]);
+      answer.positions.push_back(id);
+
+      // One more door leads out of a region on the field boundary
+      if (touches_field_boundary(positions_[id].polygon_ids)) {
+        answer.number_of_doors = number_of_walls + 1;
+        break;
+      }
+
+      // Skip the region if it has already been entered from the same parent
+      // region with fewer doors
+      signatures.push_back(region_signature(positions_[id].polygon_ids));
+      const auto &signature = signatures.back();
+      const auto &parent_signature =
+          number_of_walls > 0 ? parent_signatures[parents[i]] : signature;
+      auto [region, inserted] = explored.try_emplace(
+          std::pair(parent_signature, signature), number_of_walls);
+      if (!inserted && region->second != number_of_walls) {
+        continue;
+      }
+
+      const auto &doors = this->doors(id);
+      next_level.insert(next_level.end(), doors.begin(), doors.end());
+      next_parents.insert(next_parents.end(), doors.size(), i);
+    }
+    level.swap(next_level);
+    parents.swap(next_parents);
+    parent_signatures.swap(signatures);
+  }
+
+  answers_[key] = answer;
+  return answer.number_of_doors;
+}
+
+}  // namespace Treasure_Hunt
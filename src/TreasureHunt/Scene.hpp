@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "DoorSearch.hpp"
+#include "RayCastContext.hpp"
+#include "TreasureHunt.hpp"
+#include "WallGrid.hpp"
+#include "WallSet.hpp"
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief A field whose walls are edited one at a time, answering door counts
+ * incrementally.
+ *
+ * Every position the searches have reached keeps its region (the walls found
+ * by the ray casting, with the nearest hit of every ray) and the doors out of
+ * it. An edit only invalidates the positions it can change: an added wall is
+ * tested against the rays of every position, and a removed wall invalidates
+ * the positions whose rays it was the nearest wall of. The answer for a
+ * treasure point is reused as long as every position it went through is
+ * still valid, and a new search recomputes only the invalidated positions.
+ *
+ * The answers are the ones of calc_number_of_doors on walls().
+ */
+class Scene {
+ private:
+  /**
+   * @brief A position of the traversal and the results cached for it.
+   */
+  struct Position {
+    TraverseNode node;
+    bool valid = false;
+    std::vector<std::size_t> polygon_ids;
+    std::vector<RayCastContext::RayHit> ray_hits;
+    bool doors_valid = false;
+    std::vector<TraverseNode> doors;
+  };
+
+  /**
+   * @brief The door count for a treasure point and the positions it depends
+   * on.
+   */
+  struct Answer {
+    std::optional<std::size_t> number_of_doors;
+    std::vector<std::size_t> positions;
+  };
+
+  // The treasure point and the coordinates of the entering wall
+  using PositionKey =
+      std::tuple<double, double, double, double, double, double>;
+  // The sorted coordinates of the walls of a region
+  using RegionSignature =
+      std::vector<std::tuple<double, double, double, double>>;
+
+  FieldConfig config_;
+  std::vector<Wall> outer_walls_;
+  WallSet walls_;
+  std::size_t wall_count_ = 0;
+  std::optional<WallGrid> grid_;
+  std::optional<RayCastContext> ray_cast_;
+  std::size_t grid_size_ = 0;
+
+  std::vector<Position> positions_;
+  std::map<PositionKey, std::size_t> position_ids_;
+  // Positions which may change with every wall id; the last entry is the
+  // zero wall reported for degenerate rays
+  std::vector<std::vector<std::size_t>> wall_positions_;
+  std::map<std::pair<double, double>, Answer> answers_;
+
+  void invalidate_positions(std::size_t id);
+  void prepare_ray_cast();
+  std::size_t position(const TraverseNode &node);
+  const std::vector<TraverseNode> &doors(std::size_t id);
+  bool touches_field_boundary(
+      const std::vector<std::size_t> &polygon_ids) const;
+  RegionSignature region_signature(
+      const std::vector<std::size_t> &polygon_ids) const;
+
+ public:
+  explicit Scene(const FieldConfig &config = FieldConfig());
+
+  std::size_t add_wall(const Wall &wall);
+  void remove_wall(std::size_t id);
+
+  std::vector<Wall> walls() const;
+
+  std::optional<std::size_t> number_of_doors(const Point &treasure_point);
+};
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,79 @@
+#include "SearchStatistics.hpp"
+
+namespace Treasure_Hunt {
+
+LevelStatistics &LevelStatistics::operator+=(const LevelStatistics &level) {
+  positions += level.positions;
+  ray_casts += level.ray_casts;
+  rays += level.rays;
+  intersections += level.intersections;
+  door_intersections += level.door_intersections;
+  regions_explored += level.regions_explored;
+  regions_pruned += level.regions_pruned;
+  doors += level.doors;
+  seconds += level.seconds;
+  return *this;
+}
+
+/**
+ * @brief Sums the statistics of every level.
+ */
+LevelStatistics SearchStatistics::total() const {
+  LevelStatistics total;
+  for (const auto &level : levels) {
+    total += level;
+  }
+  return total;
+}
+
+/**
+ * @brief Writes the fields of the statistics of one level as the members of
+ * a JSON object.
+ */
+static void write_json_fields(std::ostream &os, const LevelStatistics &level) {
+  os << "\"positions\": " << level.positions
+     << ", \"ray_casts\": " << level.ray_casts << ", \"rays\": " << level.rays
+     << ", \"intersections\": " << level.intersections
+     << ", \"door_intersections\": " << level.door_intersections
+     << ", \"regions_explored\": " << level.regions_explored
+     << ", \"regions_pruned\": " << level.regions_pruned
+     << ", \"doors\": " << level.doors << ", \"seconds\": " << level.seconds;
+}
+
+void SearchStatistics::write_json(std::ostream &os) const {
+  os << "{\n  \"levels\": [";
+  for (std::size_t depth = 0; depth < levels.size(); depth++) {
+    os << (depth ? ",\n" : "\n") << "    {\"depth\": " << depth << ", ";
+    write_json_fields(os, levels[depth]);
+    os << "}";
+  }
+  os << (levels.empty() ? "" : "\n  ") << "],\n  \"total\": {";
+  write_json_fields(os, total());
+  os << "}\n}\n";
+}
+
+/**
+ * @brief Prints the statistics as a table with one line per level and the
+ * total.
+ */
+std::ostream &operator<<(std::ostream &os,
+                         const SearchStatistics &statistics) {
+  auto print_level = [&](const LevelStatistics &level) {
+    os << " positions " << level.positions << ", ray casts "
+       << level.ray_casts << ", rays " << level.rays << ", intersections "
+       << level.intersections << " + " << level.door_intersections
+       << ", explored " << level.regions_explored << ", pruned "
+       << level.regions_pruned << ", doors " << level.doors << ", "
+       << level.seconds << " s" << std::endl;
+  };
+
+  for (std::size_t depth = 0; depth < statistics.levels.size(); depth++) {
+    os << "depth " << depth << ":";
+    print_level(statistics.levels[depth]);
+  }
+  os << "total:";
+  print_level(statistics.total());
+  return os;
+}
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief The work done on one level of the door search: the positions
+ * reached through the same number of doors.
+ */
+struct LevelStatistics {
+  std::size_t positions = 0;           // positions of the level
+  std::size_t ray_casts = 0;           // positions whose rays were cast
+  std::size_t rays = 0;                // rays cast
+  std::size_t intersections = 0;       // intersections of rays and walls
+  std::size_t door_intersections = 0;  // intersections in the door search
+  std::size_t regions_explored = 0;    // positions in regions entered first
+  std::size_t regions_pruned = 0;      // positions in regions already explored
+  std::size_t doors = 0;               // positions queued for the next level
+  double seconds = 0;
+
+  LevelStatistics &operator+=(const LevelStatistics &level);
+};
+
+/**
+ * @brief Instrumentation of find_door_path, one entry per level of the
+ * search in the order they are visited.
+ */
+struct SearchStatistics {
+  std::vector<LevelStatistics> levels;
+
+  LevelStatistics total() const;
+
+  /**
+   * @brief Writes the statistics as a JSON object with the levels and their
+   * total, for offline analysis.
+   */
+  void write_json(std::ostream &os) const;
+
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const SearchStatistics &statistics);
+};
+
+}  // namespace Treasure_Hunt
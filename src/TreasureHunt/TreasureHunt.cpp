@@ -2,22 +2,28 @@
 
 #include <limits>
 #include <sstream>
-
-#define MAXIMUM_WALLS 30
-#define PHI_STEP 5
-#define RAY_COUNT 360 / PHI_STEP
+#include <stdexcept>
 
 #define NUMBER_OF_OUTER_WALLS 4
-#define FIELD_START_BOUNDARY 0
-#define FIELD_END_BOUNDARY 100
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <functional>
-#include <unordered_map>
+#include <numeric>
+#include <tuple>
+#include <map>
 #include <unordered_set>
 #include <vector>
 
+#include "DoorSearch.hpp"
+#include "RayCastContext.hpp"
+#include "SearchStatistics.hpp"
+#include "WallGrid.hpp"
+#include "WallSet.hpp"
+#include "WorkStealingPool.hpp"
+
 namespace Treasure_Hunt {
 
 Point::Point(double x, double y) : x_(x), y_(y) {}
@@ -53,6 +59,7 @@ double Point::get_distance_with_point(const Point &point) const {
 /**
  * @brief Checks if the point is out of the field.
  *
+ * @param field The field box.
  * @return True if the point is out of the field, false otherwise.
  *
  * This function checks if the point is out of the field by comparing its
@@ -61,13 +68,15 @@ double Point::get_distance_with_point(const Point &point) const {
  * comparisons is true, the function returns true, indicating that the point is
  * out of the field.
  */
-bool Point::out_of_field() const {
-  bool out_of_field_x = x_ < FIELD_START_BOUNDARY || x_ > FIELD_END_BOUNDARY;
-  bool out_of_field_y = y_ < FIELD_START_BOUNDARY || y_ > FIELD_END_BOUNDARY;
+bool Point::out_of_field(const Box &field) const {
+  bool out_of_field_x = x_ < field.x_min || x_ > field.x_max;
+  bool out_of_field_y = y_ < field.y_min || y_ > field.y_max;
 
   return out_of_field_x || out_of_field_y;
 }
 
+bool Point::out_of_field() const { return out_of_field(FieldConfig().field); }
+
 std::ostream &operator<<(std::ostream &os, const Point &wall) {
   os << "(" << wall.x_ << "," << wall.y_ << ")";
   return os;
@@ -83,6 +92,22 @@ double Point::x() const { return x_; }
 
 double Point::y() const { return y_; }
 
+/**
+ * @brief Mixes the hash of a coordinate into a hash value.
+ *
+ * @param seed The hash value so far.
+ * @param value The coordinate.
+ *
+ * @return The combined hash value.
+ *
+ * The combination depends on the order of the coordinates, so points and
+ * walls with swapped or mirrored coordinates hash differently.
+ */
+static std::size_t hash_combine(std::size_t seed, double value) {
+  return seed ^ (std::hash<double>()(value) + 0x9e3779b97f4a7c15 +
+                 (seed << 6) + (seed >> 2));
+}
+
 /**
  * @brief Hash function for Point objects.
  *
@@ -92,16 +117,10 @@ double Point::y() const { return y_; }
  *
  * This function overloads the operator() function to provide a hash function
  * for Point objects. It combines the hash values of the x-coordinate and
- * the y-coordinate of the Point object using the bitwise XOR operator.
+ * the y-coordinate of the Point object in order.
  */
 std::size_t PointHash::operator()(const Point &point) const {
-  // Get the hash values of the x-coordinate and y-coordinate of the Point
-  // object
-  std::size_t hash_x = std::hash<double>()(point.x());
-  std::size_t hash_y = std::hash<double>()(point.y());
-
-  // Combine the hash values using the bitwise XOR operator
-  return hash_x ^ hash_y;
+  return hash_combine(hash_combine(0, point.x()), point.y());
 }
 
 Wall::Wall(double x1, double y1, double x2, double y2)
@@ -142,27 +161,10 @@ double Wall::y2() const { return y2_; }
  * it calculates the intersection point using the parametric line equation.
  */
 Point Wall::intersection_point(const Wall &wall1, const Wall &wall2) {
-  // Check if the walls are parallel
-  if (is_parallel(wall1, wall2)) {
-    // Return NaN values if the walls are parallel
-    return Point(std::numeric_limits<double>::quiet_NaN(),
-                 std::numeric_limits<double>::quiet_NaN());
-  }
-
-  // Extract the coordinates of the four points defining the walls
-  double x1 = wall1.x1_, y1 = wall1.y1_, x2 = wall1.x2_, y2 = wall1.y2_;
-  double x3 = wall2.x1_, y3 = wall2.y1_, x4 = wall2.x2_, y4 = wall2.y2_;
-
-  // Calculate the x-coordinate and y-coordinate of the intersection point
-  double Px =
-      ((x1 * y2 - y1 * x2) * (x3 - x4) - (x1 - x2) * (x3 * y4 - y3 * x4)) /
-      ((x1 - x2) * (y3 - y4) - (y1 - y2) * (x3 - x4));
-  double Py =
-      ((x1 * y2 - y1 * x2) * (y3 - y4) - (y1 - y2) * (x3 * y4 - y3 * x4)) /
-      ((x1 - x2) * (y3 - y4) - (y1 - y2) * (x3 - x4));
-
-  // Return the intersection point as a Point object
-  return Point(Px, Py);
+  // The parallel check and the parametric line equation work on the
+  // coefficients of the lines through the walls
+  return LineCoefficients::intersection_point(LineCoefficients(wall1),
+                                              LineCoefficients(wall2));
 }
 
 /**
@@ -172,30 +174,14 @@ Point Wall::intersection_point(const Wall &wall1, const Wall &wall2) {
  * @param wall2 The second wall.
  * @return True if the walls are parallel, false otherwise.
  *
- * This function checks if two walls are parallel. It calculates the cosine
- * of the angle between the two walls and Ox (the x-axis) and compares the
- * values. If the cosines are equal, the walls are parallel.
+ * This function checks if two walls are parallel. It compares the cosines of
+ * the angles between the two walls and Ox (the x-axis), which are precomputed
+ * as the parallel keys of the lines through the walls. If the cosines are
+ * equal, the walls are parallel.
  */
 bool Wall::is_parallel(const Wall &wall1, const Wall &wall2) {
-  // Create a wall Ox representing the x-axis
-  Wall Ox(FIELD_START_BOUNDARY, FIELD_START_BOUNDARY, FIELD_END_BOUNDARY,
-          FIELD_START_BOUNDARY);
-
-  // Calculate the lengths of the walls and Ox
-  double dx1 = std::abs(wall1.x2_ - wall1.x1_);
-  double dx2 = std::abs(wall2.x2_ - wall2.x1_);
-  double dOx = std::abs(Ox.x2_ - Ox.x1_);
-
-  double dy1 = std::abs(wall1.y2_ - wall1.y1_);
-  double dy2 = std::abs(wall2.y2_ - wall2.y1_);
-  double dOy = std::abs(Ox.y2_ - Ox.y1_);
-
-  // Calculate the cosine of the angle between the walls and Ox
-  double cos_a1 = (dx1 * dOx + dy1 * dOy) / (dx1 * dx1 + dy1 * dy1);
-  double cos_a2 = (dx2 * dOx + dy2 * dOy) / (dx2 * dx2 + dy2 * dy2);
-
-  // Check if the cosines are equal, indicating that the walls are parallel
-  return cos_a1 == cos_a2;
+  return LineCoefficients(wall1).parallel_key ==
+         LineCoefficients(wall2).parallel_key;
 }
 
 /**
@@ -249,17 +235,32 @@ bool Wall::operator!=(const Wall &wall) const { return !(*this == wall); }
  * @return The hash value of the Wall object.
  *
  * This function overloads the operator() function to provide a hash function
- * for Wall objects. It combines the hash values of the x-coordinates,
- * y-coordinates, and z-coordinates of the Wall object using the bitwise XOR
- * operator.
+ * for Wall objects. It combines the hash values of the coordinates of the
+ * ends of the Wall object in order.
  */
 std::size_t WallHash::operator()(const Wall &wall) const {
-  // Combine the hash values of the x-coordinates, y-coordinates, and
-  // z-coordinates of the Wall object using the bitwise XOR operator
-  return std::hash<double>()(wall.x1())     // x1 coordinate
-         ^ std::hash<double>()(wall.y1())   // y1 coordinate
-         ^ std::hash<double>()(wall.x2())   // x2 coordinate
-         ^ std::hash<double>()(wall.y2());  // y2 coordinate
+  std::size_t seed = hash_combine(0, wall.x1());
+  seed = hash_combine(seed, wall.y1());
+  seed = hash_combine(seed, wall.x2());
+  return hash_combine(seed, wall.y2());
+}
+
+/**
+ * @brief Returns the length of the rays cast in the field: the longer side of
+ * the field, so that a ray from any boundary point reaches across it.
+ */
+double FieldConfig::ray_length() const {
+  return std::max(field.x_max - field.x_min, field.y_max - field.y_min);
+}
+
+/**
+ * @brief Returns the four walls along the sides of the field.
+ */
+std::vector<Wall> FieldConfig::outer_walls() const {
+  return {Wall(field.x_min, field.y_min, field.x_max, field.y_min),
+          Wall(field.x_min, field.y_min, field.x_min, field.y_max),
+          Wall(field.x_min, field.y_max, field.x_max, field.y_max),
+          Wall(field.x_max, field.y_min, field.x_max, field.y_max)};
 }
 
 /**
@@ -268,6 +269,7 @@ std::size_t WallHash::operator()(const Wall &wall) const {
  *
  * @param initial_walls The initial walls in the field
  * @param casting_point The point from which to cast the rays
+ * @param config The field parameters
  *
  * @return An unordered set of walls that the rays intersect with
  *
@@ -278,239 +280,344 @@ std::size_t WallHash::operator()(const Wall &wall) const {
  * closest to the rays.
  */
 std::unordered_set<Wall, WallHash> ray_casting(
-    const std::vector<Wall> &initial_walls, const Point &casting_point) {
-  // Define type alias for Ray
-  using Ray = Wall;
-
-  // Generate rays from the casting point
-  auto ray_generator = [&, phi = 0]() mutable {
-    int old_phi = phi++;
-    return Ray(casting_point.x(), casting_point.y(),
-               casting_point.x() + FIELD_END_BOUNDARY * std::cos(old_phi),
-               casting_point.y() + FIELD_END_BOUNDARY * std::sin(old_phi));
-  };
-  std::vector<Ray> rays(RAY_COUNT);
-  std::generate(rays.begin(), rays.end(), ray_generator);
-
-  // Store the potential walls and their intersections with the rays
-  std::unordered_map<Point, Wall, PointHash> potential_walls;
-  std::vector<Point> intersections;
-  std::unordered_set<Wall, WallHash> polygon_walls;
-
-  // Function to compare points by their distance from the casting point
-  auto compare_points_by_dist = [&](const Point &p1, const Point &p2) {
-    return p1.get_distance_with_point(casting_point) <
-           p2.get_distance_with_point(casting_point);
-  };
-
-  // Function to check if a point is beyond a ray
-  auto point_beyond_ray = [](const Point &point, const Ray &ray) {
-    double x1, y1, x2, y2;
-    std::tie(x1, x2) = (ray.x1() > ray.x2())
-                           ? std::make_tuple(ray.x2(), ray.x1())
-                           : std::make_tuple(ray.x1(), ray.x2());
-    std::tie(y1, y2) = (ray.y1() > ray.y2())
-                           ? std::make_tuple(ray.y2(), ray.y1())
-                           : std::make_tuple(ray.y1(), ray.y2());
-
-    return point.x() < x1 || point.x() > x2 || point.y() < y1 || point.y() > y2;
-  };
-
-  // Iterate over the rays and check for intersections with the initial walls
-  for (const auto &ray : rays) {
-    for (const auto &wall : initial_walls) {
-      auto intersection = Wall::intersection_point(wall, ray);
-      if (intersection.out_of_field() || Wall::is_parallel(ray, wall) ||
-          point_beyond_ray(intersection, ray)) {
-        continue;
-      }
-      // Store the intersection and the wall that it intersects with
-      intersections.push_back(intersection);
-      potential_walls[intersections.back()] = wall;
-    }
-
-    // Find the closest intersection among the intersections of the current ray
-    auto min_intersection = std::min_element(
-        intersections.begin(), intersections.end(), compare_points_by_dist);
+    const std::vector<Wall> &initial_walls, const Point &casting_point,
+    const FieldConfig &config) {
+  return ray_casting(WallSet(initial_walls), casting_point, config);
+}
 
-    if (min_intersection != intersections.end()) {
-      // Add the wall that was the closest to the ray
-      polygon_walls.insert(potential_walls[*min_intersection]);
-    }
+/**
+ * @brief Casts rays from a given point in a field and returns the nearest
+ * walls that the rays intersect with.
+ *
+ * @param walls The walls in the field
+ * @param casting_point The point from which to cast the rays
+ * @param config The field parameters
+ * @param grid The spatial index of the walls, if there is one
+ *
+ * @return An unordered set of walls that the rays intersect with
+ *
+ * The rays are cast by a RayCastContext, which the traversal keeps between
+ * the calls instead.
+ */
+std::unordered_set<Wall, WallHash> ray_casting(const WallSet &walls,
+                                               const Point &casting_point,
+                                               const FieldConfig &config,
+                                               const WallGrid *grid) {
+  RayCastContext context(walls, config, grid);
 
-    // Clear the potential walls and intersections for the next ray
-    potential_walls.clear();
-    intersections.clear();
+  std::unordered_set<Wall, WallHash> polygon_walls;
+  for (auto id : context.cast(casting_point)) {
+    polygon_walls.insert(walls.wall(id));
   }
   return polygon_walls;
 }
 
 /**
- * Recursively traverses the walls to find the minimum number of walls
- * needed to reach the treasure point.
- *
- * @param walls The vector of walls to traverse.
- * @param entering_wall The wall that led to the current position.
- * @param treasure_point The point where the treasure is located.
- * @param minimal_number_of_walls The minimum number of walls needed to reach
- * the treasure point.
- * @param number_of_walls The current number of walls encountered.
+ * @brief State shared by every step of the wall traversal.
+ *
+ * Besides the walls themselves, also stored as a WallSet for the batch
+ * intersection kernels and indexed by a WallGrid for the ray queries, it
+ * keeps a dense id for every distinct wall (the index of its first occurrence
+ * in `walls`) and the regions which have already been explored. A region is
+ * identified by its signature: the sorted dense ids of the walls found by the
+ * ray casting. A region is cut when it is entered again from the same
+ * parent region, which the search went round a cycle to do, so it is keyed
+ * by the signatures of both and kept with the number of doors it was first
+ * entered with.
  */
-void recursive_wall_traverse(std::vector<Wall> &walls, Wall entering_wall,
-                             const Point &treasure_point,
-                             std::size_t &minimal_number_of_walls,
-                             std::size_t number_of_walls = 0) {
-  // If the number of walls encountered is greater than the current minimum,
-  // stop the recursion
-  if (number_of_walls > minimal_number_of_walls) {
-    return;
+struct TraverseContext {
+  const std::vector<Wall> &walls;
+  const FieldConfig &config;
+  const std::vector<Wall> external_walls;
+  WallSet wall_set;
+  WallGrid wall_grid;
+  std::vector<std::size_t> dense_ids;
+  std::map<std::pair<std::vector<std::size_t>, std::vector<std::size_t>>,
+           std::size_t>
+      explored_regions;
+
+  TraverseContext(const std::vector<Wall> &walls, const FieldConfig &config)
+      : walls(walls),
+        config(config),
+        external_walls(config.outer_walls()),
+        wall_set(walls),
+        wall_grid(wall_set, config.field) {
+    // Number equal walls by their first occurrence: sort the ids by the
+    // coordinates of the walls and give every run of equal walls the
+    // smallest id. The zero wall reported for degenerate rays, with the id
+    // walls.size(), is the same as a zero wall of the field if there is one
+    auto coordinates = [&](std::size_t id) {
+      Wall wall = wall_set.wall(id);
+      return std::tuple(wall.x1(), wall.y1(), wall.x2(), wall.y2());
+    };
+    std::vector<std::size_t> order(walls.size() + 1);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t id1, std::size_t id2) {
+                       return coordinates(id1) < coordinates(id2);
+                     });
+
+    dense_ids.resize(walls.size() + 1);
+    std::size_t first_id = 0;
+    for (std::size_t k = 0; k < order.size(); k++) {
+      if (k == 0 || coordinates(order[k]) != coordinates(order[k - 1])) {
+        first_id = order[k];
+      }
+      dense_ids[order[k]] = first_id;
+    }
   }
 
-  // Define the epsilon value for floating point comparisons
-  double epsilon = 1e-8;
-
-  // Define the external walls of the field
-  const std::vector<Wall> external_walls = {
-      Wall(FIELD_START_BOUNDARY, FIELD_START_BOUNDARY, FIELD_END_BOUNDARY,
-           FIELD_START_BOUNDARY),
-      Wall(FIELD_START_BOUNDARY, FIELD_START_BOUNDARY, FIELD_START_BOUNDARY,
-           FIELD_END_BOUNDARY),
-      Wall(FIELD_START_BOUNDARY, FIELD_END_BOUNDARY, FIELD_END_BOUNDARY,
-           FIELD_END_BOUNDARY),
-      Wall(FIELD_END_BOUNDARY, FIELD_START_BOUNDARY, FIELD_END_BOUNDARY,
-           FIELD_END_BOUNDARY)};
-
-  // Perform ray casting to find the walls that limit the treasure point
-  auto polygon_walls = ray_casting(walls, treasure_point);
-
-  // Check if the treasure point is outside the field
-  for (const auto &wall : external_walls) {
-    if (polygon_walls.find(wall) != polygon_walls.end()) {
-      number_of_walls++;
-      minimal_number_of_walls =
-          std::min(minimal_number_of_walls, number_of_walls);
-      return;
+  /**
+   * @brief Builds the canonical signature of the region bounded by the walls
+   * with the given ids.
+   */
+  std::vector<std::size_t> region_signature(
+      const std::vector<std::size_t> &polygon_ids) const {
+    std::vector<std::size_t> signature;
+    signature.reserve(polygon_ids.size());
+    for (auto id : polygon_ids) {
+      signature.push_back(dense_ids[id]);
     }
+    std::sort(signature.begin(), signature.end());
+    signature.erase(std::unique(signature.begin(), signature.end()),
+                    signature.end());
+    return signature;
   }
 
-  // Find all possible intersections between the walls that limit the point
-  std::unordered_map<Wall, std::unordered_set<Point, PointHash>, WallHash>
-      wall_to_point_intersections;
-  for (auto wall1 : polygon_walls) {
-    for (auto wall2 : polygon_walls) {
-      if (wall1 == wall2 || Wall::is_parallel(wall1, wall2)) {
+  /**
+   * @brief Finds the door out of the field of a region, if the region touches
+   * one of the outer walls.
+   *
+   * @param ray_hits The nearest hits of the rays cast in the region.
+   * @return The outer wall reported by the first ray that hits one, crossed
+   * where that ray hits it.
+   */
+  std::optional<Door> field_exit(
+      const std::vector<RayCastContext::RayHit> &ray_hits) const {
+    for (const auto &hit : ray_hits) {
+      if (!hit.found || std::isnan(hit.x) || std::isnan(hit.y)) {
         continue;
       }
-      auto intersection = Wall::intersection_point(wall1, wall2);
-      if (intersection.out_of_field()) {
-        continue;
+      Wall wall = wall_set.wall(hit.last_wall);
+      if (std::find(external_walls.begin(), external_walls.end(), wall) !=
+          external_walls.end()) {
+        return Door{wall, Point(hit.x, hit.y)};
       }
-      wall_to_point_intersections[wall1].insert(intersection);
-      wall_to_point_intersections[wall2].insert(intersection);
     }
+    return std::nullopt;
   }
+};
+
+/**
+ * @brief The work on one position of a traversal level: the walls that limit
+ * it, the signature of its region, whether the region is new, the positions
+ * behind its doors and the door out of the field, if the region has one,
+ * together with the work done for it.
+ */
+struct TraverseStep {
+  std::vector<std::size_t> polygon_ids;
+  std::vector<std::size_t> signature;
+  bool explore = false;
+  std::vector<TraverseNode> doors;
+  std::optional<Door> exit;
+  RayCastContext::Counters ray_cast_counters;
+  std::size_t door_intersections = 0;
+};
 
-  // Find the next valid move by checking if the center of the wall is inside
-  // the intersection limits
-  for (const auto &wall_intersections : wall_to_point_intersections) {
-    auto wall = wall_intersections.first;
-    if (wall == entering_wall && wall != Wall(-1, -1, -1, -1)) {
-      continue;
+/**
+ * @brief      Finds a shortest way out of the field through the doors.
+ *
+ * @param[in]  initial_walls   The walls in the field, the outer ones included
+ * @param[in]  initial_treasure_point   The initial treasure point
+ * @param[in]  config   The field parameters
+ * @param[out] statistics   Receives the work done on every level, if given
+ *
+ * @return     The doors from the treasure point to the outside of the field,
+ * in the order they are passed, the last one on an outer wall; or nothing if
+ * the treasure cannot be reached
+ *
+ * The walls are traversed breadth-first, one door more at every level, so the
+ * first region found to touch the field boundary gives the minimal number of
+ * doors. A region entered again from the same parent region with more doors
+ * than the first time is not explored again, as the search went round a cycle
+ * to get there; any other way into a region is explored like the original
+ * depth-first search did.
+ *
+ * Every level is kept with the index of the position each of its positions
+ * was found from, so the way is read back from the exit once it is found.
+ * The inner doors are crossed at the centers of their walls, where the
+ * traversal passes them.
+ *
+ * The positions of a level are spread over config.thread_count workers: the
+ * ray casting and the search for doors run in parallel, while the regions
+ * are claimed in the order of the positions in between. The result and the
+ * order of the next level are thus the same for any number of threads.
+ */
+std::optional<std::vector<Door>> find_door_path(
+    const std::vector<Wall> &initial_walls,
+    const Point &initial_treasure_point, const FieldConfig &config,
+    SearchStatistics *statistics) {
+  if (statistics) {
+    statistics->levels.clear();
+  }
+  TraverseContext context(initial_walls, config);
+  WorkStealingPool pool(config.thread_count);
+
+  // Every worker casts rays with buffers of its own
+  std::vector<RayCastContext> ray_casts;
+  ray_casts.reserve(pool.size());
+  for (std::size_t worker = 0; worker < pool.size(); worker++) {
+    ray_casts.emplace_back(context.wall_set, config, &context.wall_grid);
+  }
+
+  // Start from the treasure point with a dummy entering wall. The levels
+  // found so far are kept together with the index of the parent of every
+  // position in the previous level
+  std::vector<std::vector<TraverseNode>> levels = {
+      {TraverseNode{Wall(-1, -1, -1, -1), initial_treasure_point}}};
+  std::vector<std::vector<std::size_t>> parents = {{0}};
+  std::vector<TraverseStep> steps;
+  std::vector<std::vector<std::size_t>> signatures;
+
+  // Records the work done on the positions of the current level up to the
+  // given one. The positions after the exit are cast only by the workers
+  // which got to them before the exit was found, so they are not counted
+  // to keep the statistics the same for any number of threads
+  auto record_level = [&](std::chrono::steady_clock::time_point start,
+                          std::size_t positions_done,
+                          LevelStatistics level_statistics) {
+    if (!statistics) {
+      return;
     }
-    auto intersections = wall_intersections.second;
-    std::vector<Point> bounds;
-
-    for (const auto &intersection : intersections) {
-      auto min_x = std::min(intersection.x(), treasure_point.x());
-      auto max_x = std::max(intersection.x(), treasure_point.x());
-      auto min_y = std::min(intersection.y(), treasure_point.y());
-      auto max_y = std::max(intersection.y(), treasure_point.y());
-      bool bound_found = true;
-
-      Wall temp_wall(treasure_point.x(), treasure_point.y(), intersection.x(),
-                     intersection.y());
-      for (const auto &checking_wall : polygon_walls) {
-        if (checking_wall == wall || checking_wall == entering_wall) {
-          continue;
-        }
-        auto intersection_point =
-            Wall::intersection_point(temp_wall, checking_wall);
-
-        // Check if the intersection point is inside the bounds of the walls
-        bool inside_bound_x = intersection_point.x() - min_x >= epsilon &&
-                              max_x - intersection_point.x() >= epsilon;
-        bool inside_bound_y = intersection_point.y() - min_y >= epsilon &&
-                              max_y - intersection_point.y() >= epsilon;
-        if (inside_bound_x && inside_bound_y) {
-          bound_found = false;
-          break;
+    for (std::size_t i = 0; i < positions_done; i++) {
+      level_statistics.ray_casts += steps[i].ray_cast_counters.casts;
+      level_statistics.rays += steps[i].ray_cast_counters.rays;
+      level_statistics.intersections +=
+          steps[i].ray_cast_counters.intersections;
+      level_statistics.door_intersections += steps[i].door_intersections;
+    }
+    level_statistics.seconds = std::chrono::duration<double>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+    statistics->levels.push_back(level_statistics);
+  };
+
+  while (!levels.back().empty()) {
+    const auto &level = levels.back();
+    steps.assign(level.size(), TraverseStep());
+    auto level_start = std::chrono::steady_clock::now();
+    LevelStatistics level_statistics;
+    level_statistics.positions = level.size();
+
+    // Perform ray casting to find the walls that limit every position. The
+    // first position on the field boundary ends the search, so the positions
+    // after the earliest one found so far are skipped
+    std::atomic<std::size_t> exit_index = level.size();
+    pool.run(level.size(), [&](std::size_t worker, std::size_t i) {
+      if (i > exit_index.load(std::memory_order_relaxed)) {
+        return;
+      }
+      auto &ray_cast = ray_casts[worker];
+      auto counters = ray_cast.counters();
+      const auto &polygon_ids = ray_cast.cast(level[i].treasure_point);
+      steps[i].ray_cast_counters = {
+          ray_cast.counters().casts - counters.casts,
+          ray_cast.counters().rays - counters.rays,
+          ray_cast.counters().intersections - counters.intersections};
+
+      // One more door leads out of a region on the field boundary
+      steps[i].exit = context.field_exit(ray_cast.ray_hits());
+      if (steps[i].exit) {
+        std::size_t current = exit_index.load(std::memory_order_relaxed);
+        while (i < current && !exit_index.compare_exchange_weak(
+                                  current, i, std::memory_order_relaxed)) {
         }
+        return;
       }
-
-      if (bound_found) {
-        bounds.push_back(intersection);
+      steps[i].polygon_ids = polygon_ids;
+      steps[i].signature = context.region_signature(polygon_ids);
+    });
+    if (exit_index < level.size()) {
+      record_level(level_start, exit_index + 1, level_statistics);
+
+      // Walk back from the exit to the treasure point
+      std::vector<Door> path = {*steps[exit_index].exit};
+      for (std::size_t depth = levels.size() - 1, i = exit_index; depth > 0;
+           i = parents[depth][i], depth--) {
+        const auto &wall = levels[depth][i].entering_wall;
+        path.push_back(Door{wall, wall.get_center()});
       }
+      std::reverse(path.begin(), path.end());
+      return path;
     }
 
-    if (bounds.empty()) {
-      continue;
+    // Skip the regions which have already been entered from the same parent
+    // region with fewer doors
+    std::size_t depth = levels.size() - 1;
+    for (std::size_t i = 0; i < steps.size(); i++) {
+      auto &step = steps[i];
+      const auto &parent_signature =
+          depth > 0 ? signatures[parents[depth][i]] : step.signature;
+      auto [region, inserted] = context.explored_regions.try_emplace(
+          std::pair(parent_signature, step.signature), depth);
+      step.explore = inserted || region->second == depth;
+      level_statistics.regions_explored += step.explore;
     }
-
-    // Find the bounds of the intersection limits
-    auto comp = [](const Point &p1, const Point &p2) {
-      return p1.get_distance_with_point(Point(0, 0)) <
-             p2.get_distance_with_point(Point(0, 0));
-    };
-    auto first_bound = *std::min_element(bounds.begin(), bounds.end(), comp);
-    auto second_bound = *std::max_element(bounds.begin(), bounds.end(), comp);
-
-    // Check if the center of the wall is inside the bounds
-    auto center = wall.get_center();
-    if (center.x() <= second_bound.x() && center.x() >= first_bound.x() &&
-        center.y() <= second_bound.y() && center.y() >= first_bound.y()) {
-      double dx = (center.x() - treasure_point.x());
-      double dy = (center.y() - treasure_point.y());
-      double dist = std::sqrt(dx * dx + dy * dy);
-      dx /= (dist);
-      dy /= (dist);
-      dx /= (dist);
-      dy /= (dist);
-
-      Point new_treasure_point = Point(center.x() + dx, center.y() + dy);
-      recursive_wall_traverse(walls, wall, new_treasure_point,
-                              minimal_number_of_walls, number_of_walls + 1);
+    level_statistics.regions_pruned =
+        level.size() - level_statistics.regions_explored;
+
+    pool.run(level.size(), [&](std::size_t, std::size_t i) {
+      if (steps[i].explore) {
+        steps[i].door_intersections =
+            find_doors(context.wall_set, config.field, steps[i].polygon_ids,
+                       level[i], steps[i].doors);
+      }
+    });
+
+    // Queue the positions behind the doors in the order of their regions
+    std::vector<TraverseNode> next_level;
+    std::vector<std::size_t> next_parents;
+    for (std::size_t i = 0; i < steps.size(); i++) {
+      next_level.insert(next_level.end(), steps[i].doors.begin(),
+                        steps[i].doors.end());
+      next_parents.insert(next_parents.end(), steps[i].doors.size(), i);
     }
+    level_statistics.doors = next_level.size();
+    record_level(level_start, level.size(), level_statistics);
+    signatures.clear();
+    for (auto &step : steps) {
+      signatures.push_back(std::move(step.signature));
+    }
+    levels.push_back(std::move(next_level));
+    parents.push_back(std::move(next_parents));
   }
+
+  return std::nullopt;
 }
 
 /**
  * @brief      Calculates the number of doors in a field.
  *
- * @param[in]  initial_walls   The initial walls in the field
+ * @param[in]  initial_walls   The walls in the field, the outer ones included
  * @param[in]  initial_treasure_point   The initial treasure point
+ * @param[in]  config   The field parameters
+ * @param[out] statistics   Receives the work done by the search, if given
  *
- * @return     The number of doors in the field
+ * @return     The number of doors in the field, or nothing if the treasure
+ * cannot be reached
  *
- * The algorithm recursively traverses the walls to find the minimum number of
- * walls needed to reach the treasure point.
+ * This is the length of the way found by find_door_path.
  */
-std::size_t calc_number_of_doors(const std::vector<Wall> &initial_walls,
-                                 const Point &initial_treasure_point) {
-  // Copy the initial treasure point to avoid modifying the original one
-  Point treasure_point = initial_treasure_point;
-
-  // Initialize the minimal number of walls to the maximum possible value
-  std::size_t minimal_number_of_walls = MAXIMUM_WALLS;
-
-  // Recursively traverse the walls to find the minimum number of doors
-  recursive_wall_traverse(
-      const_cast<std::vector<Wall> &>(
-          initial_walls),    // Cast away constness to avoid duplicating code
-      Wall(-1, -1, -1, -1),  // Dummy wall to initiate recursion
-      treasure_point, minimal_number_of_walls, 0);  // Start from the first wall
-
-  // Return the minimal number of doors
-  return minimal_number_of_walls;
+std::optional<std::size_t> calc_number_of_doors(
+    const std::vector<Wall> &initial_walls,
+    const Point &initial_treasure_point, const FieldConfig &config,
+    SearchStatistics *statistics) {
+  auto path = find_door_path(initial_walls, initial_treasure_point, config,
+                             statistics);
+  if (!path) {
+    return std::nullopt;
+  }
+  return path->size();
 }
 
 /**
@@ -518,6 +625,8 @@ std::size_t calc_number_of_doors(const std::vector<Wall> &initial_walls,
  *
  * @param[in]  input   The input stream containing the field information and
  *                    the treasure point.
+ * @param[in]  config   The field parameters
+ * @param[out] statistics   Receives the work done by the search, if given
  *
  * @return     The solution string containing the number of doors to the
  * treasure.
@@ -525,55 +634,52 @@ std::size_t calc_number_of_doors(const std::vector<Wall> &initial_walls,
  * This function reads the input from the input stream, extracts the number of
  * walls and their coordinates, and the treasure point coordinates. It then
  * calculates the number of doors needed to reach the treasure using the
- * calc_number_of_doors function. If the number of doors is greater than or
- * equal to the maximum number of walls, it returns a string indicating that it
- * is impossible to reach the treasure. Otherwise, it returns a string
- * containing the number of doors.
+ * calc_number_of_doors function. If the treasure cannot be reached, it returns
+ * a string indicating that it is impossible to reach the treasure. Otherwise,
+ * it returns a string containing the number of doors.
  */
-std::string handle_treasure_hunt(std::istream &input) {
+std::string handle_treasure_hunt(std::istream &input,
+                                 const FieldConfig &config,
+                                 SearchStatistics *statistics) {
   std::stringstream result;
 
   // Read the number of walls from the input stream
   std::size_t number_of_walls;
   input >> number_of_walls;
+  if (number_of_walls > config.maximum_walls) {
+    throw std::invalid_argument("Too many walls");
+  }
+
+  // Create a vector to store the walls, starting with the outer walls of the
+  // field
+  std::vector<Wall> walls = config.outer_walls();
+  walls.reserve(number_of_walls + NUMBER_OF_OUTER_WALLS);
 
-  // Create a vector to store the walls
-  std::vector<Wall> walls(number_of_walls + NUMBER_OF_OUTER_WALLS);
-
-  // Initialize the outer walls of the field
-  walls[0] = Wall(FIELD_START_BOUNDARY, FIELD_START_BOUNDARY,
-                  FIELD_END_BOUNDARY, FIELD_START_BOUNDARY);
-  walls[1] = Wall(FIELD_START_BOUNDARY, FIELD_START_BOUNDARY,
-                  FIELD_START_BOUNDARY, FIELD_END_BOUNDARY);
-  walls[2] = Wall(FIELD_START_BOUNDARY, FIELD_END_BOUNDARY, FIELD_END_BOUNDARY,
-                  FIELD_END_BOUNDARY);
-  walls[3] = Wall(FIELD_END_BOUNDARY, FIELD_START_BOUNDARY, FIELD_END_BOUNDARY,
-                  FIELD_END_BOUNDARY);
-
-  // Read the coordinates of the walls from the input stream
-  for (std::size_t i = NUMBER_OF_OUTER_WALLS;
-       i < number_of_walls + NUMBER_OF_OUTER_WALLS; i++) {
-    double x1, y1, x2, y2;
+  // Read the coordinates of the walls from the input stream. A coordinate
+  // missing from a short input is read as 0, and so are the ones after it
+  for (std::size_t i = 0; i < number_of_walls; i++) {
+    double x1 = 0, y1 = 0, x2 = 0, y2 = 0;
     input >> x1 >> y1 >> x2 >> y2;
-    walls[i] = Wall(x1, y1, x2, y2);
+    walls.push_back(Wall(x1, y1, x2, y2));
   }
 
   // Read the coordinates of the treasure point from the input stream
-  double treasure_x, treasure_y;
+  double treasure_x = 0, treasure_y = 0;
   input >> treasure_x >> treasure_y;
 
   // Calculate the number of doors needed to reach the treasure
   auto number_of_doors =
-      calc_number_of_doors(walls, Point(treasure_x, treasure_y));
+      calc_number_of_doors(walls, Point(treasure_x, treasure_y), config,
+                           statistics);
 
   // Check if the number of doors is possible
-  if (number_of_doors >= MAXIMUM_WALLS) {
+  if (!number_of_doors) {
     result << "Impossible to get to the given treasure point" << std::endl;
   } else {
-    result << "Number of doors = " << number_of_doors << std::endl;
+    result << "Number of doors = " << *number_of_doors << std::endl;
   }
 
   return result.str();
 }
 
-}  // namespace Treasure_Hunt
\ No newline at end of file
+}  // namespace Treasure_Hunt
@@ -2,11 +2,20 @@
 
 #include <cstddef>
 #include <iostream>
+#include <optional>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
 namespace Treasure_Hunt {
 
+/**
+ * @brief Axis-aligned box [x_min, x_max] x [y_min, y_max].
+ */
+struct Box {
+  double x_min, y_min, x_max, y_max;
+};
+
 class Point {
  private:
   double x_, y_;
@@ -23,6 +32,7 @@ class Point {
   double get_distance_with_point(const Point &point) const;
 
   bool out_of_field() const;
+  bool out_of_field(const Box &field) const;
 
   bool operator==(const Point &point) const;
   bool operator!=(const Point &point) const;
@@ -67,12 +77,60 @@ struct WallHash {
   std::size_t operator()(const Wall &wall) const;
 };
 
-std::unordered_set<Wall, WallHash> ray_casting(
-    const std::vector<Wall> &initial_walls, const Point &casting_point);
+/**
+ * @brief Runtime parameters of a treasure hunt.
+ *
+ * The field is closed by four outer walls along its sides. The rays are cast
+ * at the angles 0, phi_step, 2 * phi_step, ... radians; the defaults give the
+ * original 100 x 100 field with 72 rays one radian apart. The search runs on
+ * thread_count threads, one per hardware thread if it is 0.
+ */
+struct FieldConfig {
+  Box field{0, 0, 100, 100};
+  std::size_t ray_count = 72;
+  double phi_step = 1;
+  std::size_t maximum_walls = 100000;
+  std::size_t thread_count = 1;
+
+  double ray_length() const;
+  std::vector<Wall> outer_walls() const;
+};
 
-std::size_t calc_number_of_doors(const std::vector<Wall> &initial_walls,
-                                 const Point &initial_treasure_point);
+/**
+ * @brief A door on the way out of the field: the wall passed and the point
+ * where the way crosses it.
+ */
+struct Door {
+  Wall wall;
+  Point crossing_point;
+};
+
+class WallSet;
+class WallGrid;
+struct SearchStatistics;
 
-std::string handle_treasure_hunt(std::istream &input);
+std::unordered_set<Wall, WallHash> ray_casting(
+    const std::vector<Wall> &initial_walls, const Point &casting_point,
+    const FieldConfig &config = FieldConfig());
+std::unordered_set<Wall, WallHash> ray_casting(
+    const WallSet &walls, const Point &casting_point,
+    const FieldConfig &config = FieldConfig(),
+    const WallGrid *grid = nullptr);
+
+std::optional<std::vector<Door>> find_door_path(
+    const std::vector<Wall> &initial_walls,
+    const Point &initial_treasure_point,
+    const FieldConfig &config = FieldConfig(),
+    SearchStatistics *statistics = nullptr);
+
+std::optional<std::size_t> calc_number_of_doors(
+    const std::vector<Wall> &initial_walls,
+    const Point &initial_treasure_point,
+    const FieldConfig &config = FieldConfig(),
+    SearchStatistics *statistics = nullptr);
+
+std::string handle_treasure_hunt(std::istream &input,
+                                 const FieldConfig &config = FieldConfig(),
+                                 SearchStatistics *statistics = nullptr);
 
 }  // namespace Treasure_Hunt
@@ -0,0 +1,319 @@
+#include "WallGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+// Maximum number of cells along one side of the grid
+#define MAXIMUM_GRID_SIDE 64
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Clips the line x = x0 + t * dx, y = y0 + t * dy to a box.
+ *
+ * @param t_min, t_max The parameter range, narrowed to the part of the line
+ * inside the box.
+ * @return False if that part is empty.
+ */
+static bool clip_to_box(double x0, double y0, double dx, double dy,
+                        const Box &box, double &t_min, double &t_max) {
+  // Narrows the parameter range to the slab [lo, hi] of one axis
+  auto clip_axis = [&](double start, double delta, double lo, double hi) {
+    if (delta == 0) {
+      return start >= lo && start <= hi;
+    }
+    double t1 = (lo - start) / delta;
+    double t2 = (hi - start) / delta;
+    t_min = std::max(t_min, std::min(t1, t2));
+    t_max = std::min(t_max, std::max(t1, t2));
+    return t_min <= t_max;
+  };
+
+  return clip_axis(x0, dx, box.x_min, box.x_max) &&
+         clip_axis(y0, dy, box.y_min, box.y_max);
+}
+
+/**
+ * @brief Builds the grid for the walls of the set.
+ *
+ * @param walls The walls; the grid keeps a reference to them.
+ * @param field The field box; intersections outside it are never kept.
+ *
+ * The grid has about sqrt(n) cells per side for n walls, so a line crosses a
+ * small part of the cells, and the lists of all cells are stored one after
+ * another.
+ */
+WallGrid::WallGrid(const WallSet &walls, const Box &field)
+    : walls_(walls), field_(field) {
+  std::size_t side = static_cast<std::size_t>(
+      std::sqrt(static_cast<double>(walls.size())));
+  side = std::clamp<std::size_t>(side, 1, MAXIMUM_GRID_SIDE);
+  columns_ = rows_ = side;
+  cell_width_ = (field.x_max - field.x_min) / columns_;
+  cell_height_ = (field.y_max - field.y_min) / rows_;
+  margin_ = 1e-3 * std::min(cell_width_, cell_height_);
+
+  for (std::size_t id = 0; id < walls.size(); id++) {
+    if (is_point(id) && !walls.removed(id)) {
+      point_walls_.push_back(id);
+    }
+  }
+
+  // Count the walls of every cell, then fill the lists
+  std::vector<std::size_t> counts(columns_ * rows_ + 1, 0);
+  for (std::size_t id = 0; id < walls.size(); id++) {
+    rasterize(id, [&](std::size_t cell) { counts[cell]++; });
+  }
+
+  cell_offsets_.assign(columns_ * rows_ + 1, 0);
+  for (std::size_t cell = 0; cell < columns_ * rows_; cell++) {
+    cell_offsets_[cell + 1] = cell_offsets_[cell] + counts[cell];
+  }
+
+  cell_walls_.resize(cell_offsets_.back());
+  std::vector<std::size_t> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+  for (std::size_t id = 0; id < walls.size(); id++) {
+    rasterize(id, [&](std::size_t cell) {
+      cell_walls_[fill[cell]++] = static_cast<std::uint32_t>(id);
+    });
+  }
+}
+
+/**
+ * @brief Makes a wall added to the set after the grid was built visible to
+ * the rays.
+ */
+void WallGrid::add(std::size_t id) {
+  if (is_point(id)) {
+    point_walls_.push_back(id);
+  } else {
+    unplaced_walls_.push_back(id);
+  }
+}
+
+std::size_t WallGrid::unplaced_count() const { return unplaced_walls_.size(); }
+
+bool WallGrid::is_point(std::size_t id) const {
+  Wall wall = walls_.wall(id);
+  return wall.x1() == wall.x2() && wall.y1() == wall.y2();
+}
+
+std::size_t WallGrid::column(double x) const {
+  double cell = std::floor((x - field_.x_min) / cell_width_);
+  return static_cast<std::size_t>(
+      std::clamp(cell, 0.0, static_cast<double>(columns_ - 1)));
+}
+
+std::size_t WallGrid::row(double y) const {
+  double cell = std::floor((y - field_.y_min) / cell_height_);
+  return static_cast<std::size_t>(
+      std::clamp(cell, 0.0, static_cast<double>(rows_ - 1)));
+}
+
+/**
+ * @brief Calls visit for every cell crossed by the line through the wall.
+ *
+ * The line is clipped to the field grown by the margin and every column it
+ * spans is walked, visiting the cells between the lowest and the highest
+ * point of the line in the column, again grown by the margin. Zero-length
+ * walls are not lines and are skipped, as are removed walls.
+ */
+template <typename Visit>
+void WallGrid::rasterize(std::size_t id, Visit visit) const {
+  Wall wall = walls_.wall(id);
+  double dx = wall.x2() - wall.x1();
+  double dy = wall.y2() - wall.y1();
+  if (walls_.removed(id) || (dx == 0 && dy == 0)) {
+    return;
+  }
+
+  Box grown{field_.x_min - margin_, field_.y_min - margin_,
+            field_.x_max + margin_, field_.y_max + margin_};
+  double t_min = -std::numeric_limits<double>::infinity();
+  double t_max = std::numeric_limits<double>::infinity();
+  if (!clip_to_box(wall.x1(), wall.y1(), dx, dy, grown, t_min, t_max)) {
+    return;
+  }
+  Point a(wall.x1() + t_min * dx, wall.y1() + t_min * dy);
+  Point b(wall.x1() + t_max * dx, wall.y1() + t_max * dy);
+  if (a.x() > b.x()) {
+    std::swap(a, b);
+  }
+
+  for (std::size_t i = column(a.x() - margin_); i <= column(b.x() + margin_);
+       i++) {
+    double x_lo = std::max(a.x(), field_.x_min + i * cell_width_ - margin_);
+    double x_hi =
+        std::min(b.x(), field_.x_min + (i + 1) * cell_width_ + margin_);
+    if (x_lo > x_hi) {
+      continue;
+    }
+
+    double y_lo = std::min(a.y(), b.y());
+    double y_hi = std::max(a.y(), b.y());
+    if (a.x() != b.x()) {
+      double slope = (b.y() - a.y()) / (b.x() - a.x());
+      double y1 = a.y() + (x_lo - a.x()) * slope;
+      double y2 = a.y() + (x_hi - a.x()) * slope;
+      y_lo = std::min(y1, y2);
+      y_hi = std::max(y1, y2);
+    }
+
+    for (std::size_t j = row(y_lo - margin_); j <= row(y_hi + margin_); j++) {
+      visit(j * columns_ + i);
+    }
+  }
+}
+
+/**
+ * @brief Collects the walls which may hold the nearest intersection of the
+ * ray and intersects them with it.
+ *
+ * The cells are visited in the order the ray enters them. Every new wall of
+ * a cell is intersected with the ray at once, and the walk stops when the
+ * next cell starts farther than the nearest kept intersection plus the
+ * margin, or at the end of the ray. Ties are resolved by the caller, so the
+ * candidates are finally listed by id as a full scan would see them.
+ *
+ * While no wall with a smaller id than the first live zero-length wall is
+ * kept, the walk goes on to the end of the ray. If it finds none, that wall
+ * is the first one kept by the full scan, and it is added as a candidate
+ * with its NaN intersection; otherwise the full scan passes over it.
+ */
+bool WallGrid::cast_ray(const Wall &ray, Query &query) const {
+  query.ids.clear();
+  if (query.stamp.size() != walls_.size()) {
+    query.stamp.assign(walls_.size(), 0);
+    query.generation = 0;
+  }
+  if (++query.generation == 0) {
+    std::fill(query.stamp.begin(), query.stamp.end(), 0);
+    query.generation = 1;
+  }
+
+  double x0 = ray.x1(), y0 = ray.y1();
+  double dx = ray.x2() - x0, dy = ray.y2() - y0;
+  double length = std::sqrt(dx * dx + dy * dy);
+  double nearest = std::numeric_limits<double>::infinity();
+
+  // The first zero-length wall which has not been removed, and whether a
+  // wall before it is kept
+  auto point_wall = std::find_if(
+      point_walls_.begin(), point_walls_.end(),
+      [&](std::size_t id) { return !walls_.removed(id); });
+  bool kept_before_point = point_wall == point_walls_.end();
+
+  // Intersects the walls appended since `first` and updates the nearest hit
+  auto test_new_walls = [&](std::size_t first) {
+    std::size_t count = query.ids.size();
+    query.px.resize(count);
+    query.py.resize(count);
+    query.kept.resize(count);
+    walls_.cast_ray(ray, field_, query.ids.data() + first, count - first,
+                    query.px.data() + first, query.py.data() + first,
+                    query.kept.data() + first);
+    for (std::size_t k = first; k < count; k++) {
+      if (!query.kept[k]) {
+        continue;
+      }
+      if (std::isnan(query.px[k]) || std::isnan(query.py[k])) {
+        return false;
+      }
+      double a = query.py[k] - y0;
+      double b = query.px[k] - x0;
+      nearest = std::min(nearest, std::sqrt(a * a + b * b));
+      kept_before_point = kept_before_point || query.ids[k] < *point_wall;
+    }
+    return true;
+  };
+
+  for (auto id : unplaced_walls_) {
+    query.stamp[id] = query.generation;
+    query.ids.push_back(id);
+  }
+  if (!test_new_walls(0)) {
+    return false;
+  }
+
+  // Clip the ray to the field grown by the margin
+  Box grown{field_.x_min - margin_, field_.y_min - margin_,
+            field_.x_max + margin_, field_.y_max + margin_};
+  double t_min = 0, t_max = 1;
+  if (clip_to_box(x0, y0, dx, dy, grown, t_min, t_max)) {
+    std::size_t i = column(x0 + t_min * dx);
+    std::size_t j = row(y0 + t_min * dy);
+
+    // Parameters of the next vertical and horizontal cell borders (DDA)
+    const double infinity = std::numeric_limits<double>::infinity();
+    int step_i = dx > 0 ? 1 : (dx < 0 ? -1 : 0);
+    int step_j = dy > 0 ? 1 : (dy < 0 ? -1 : 0);
+    double next_x = field_.x_min + (i + (step_i > 0)) * cell_width_;
+    double next_y = field_.y_min + (j + (step_j > 0)) * cell_height_;
+    double t_next_i = step_i ? (next_x - x0) / dx : infinity;
+    double t_next_j = step_j ? (next_y - y0) / dy : infinity;
+    double t_delta_i = step_i ? cell_width_ / std::abs(dx) : infinity;
+    double t_delta_j = step_j ? cell_height_ / std::abs(dy) : infinity;
+    double t_entry = t_min;
+
+    while (t_entry * length <= nearest + 4 * margin_ || !kept_before_point) {
+      // Take the walls of the cell which have not been seen yet
+      std::size_t cell = j * columns_ + i;
+      std::size_t first = query.ids.size();
+      for (std::size_t k = cell_offsets_[cell]; k < cell_offsets_[cell + 1];
+           k++) {
+        std::size_t id = cell_walls_[k];
+        if (query.stamp[id] != query.generation) {
+          query.stamp[id] = query.generation;
+          query.ids.push_back(id);
+        }
+      }
+      if (!test_new_walls(first)) {
+        return false;
+      }
+
+      // Step to the next cell along the ray
+      if (t_next_i < t_next_j) {
+        t_entry = t_next_i;
+        t_next_i += t_delta_i;
+        if ((step_i < 0 && i == 0) || (step_i > 0 && i + 1 == columns_)) {
+          break;
+        }
+        i = step_i > 0 ? i + 1 : i - 1;
+      } else {
+        t_entry = t_next_j;
+        t_next_j += t_delta_j;
+        if ((step_j < 0 && j == 0) || (step_j > 0 && j + 1 == rows_)) {
+          break;
+        }
+        j = step_j > 0 ? j + 1 : j - 1;
+      }
+      if (t_entry > t_max) {
+        break;
+      }
+    }
+  }
+
+  if (!kept_before_point) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    query.ids.push_back(*point_wall);
+    query.px.push_back(nan);
+    query.py.push_back(nan);
+    query.kept.push_back(1);
+  }
+
+  // List the candidates by id, the order a full scan would see them in
+  query.order.resize(query.ids.size());
+  for (std::size_t k = 0; k < query.order.size(); k++) {
+    query.order[k] = k;
+  }
+  std::sort(query.order.begin(), query.order.end(),
+            [&](std::size_t k1, std::size_t k2) {
+              return query.ids[k1] < query.ids[k2];
+            });
+
+  return true;
+}
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "WallSet.hpp"
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Uniform grid over the field answering the ray queries of
+ * ray_casting.
+ *
+ * The intersection tests treat a wall as the line through it, so every wall
+ * is listed in each cell its line crosses inside the field, with a small
+ * margin to absorb rounding. A ray walks the cells it crosses in order (DDA)
+ * and stops as soon as no unvisited cell can hold a nearer intersection, so
+ * it only touches the walls around the casting point.
+ *
+ * Walls added to the set later are tested by every ray until the grid is
+ * built again; removed walls stay in their cells and are rejected by
+ * WallSet::cast_ray.
+ *
+ * Zero-length walls are not lines: the full scan keeps them on every ray
+ * with a NaN intersection, which only matters to a ray when no wall with a
+ * smaller id is kept. They are listed apart, and a ray walks on to its end
+ * while they can still matter.
+ */
+class WallGrid {
+ public:
+  /**
+   * @brief Buffers of one ray query, reused between the queries.
+   *
+   * After WallGrid::cast_ray px, py and kept hold the results of
+   * WallSet::cast_ray for the candidate walls ids, and order lists the
+   * candidates by increasing id.
+   */
+  struct Query {
+    std::vector<std::size_t> ids;
+    std::vector<double> px, py;
+    std::vector<unsigned char> kept;
+
+    std::vector<std::uint32_t> stamp;
+    std::uint32_t generation = 0;
+    std::vector<std::size_t> order;
+  };
+
+ private:
+  const WallSet &walls_;
+  Box field_;
+  std::size_t columns_, rows_;
+  double cell_width_, cell_height_;
+  double margin_;
+
+  // Walls listed in every cell, stored as offsets into cell_walls_
+  std::vector<std::size_t> cell_offsets_;
+  std::vector<std::uint32_t> cell_walls_;
+  // Walls tested by every ray: the walls added after the grid was built
+  std::vector<std::size_t> unplaced_walls_;
+  // Zero-length walls, by increasing id
+  std::vector<std::size_t> point_walls_;
+
+  bool is_point(std::size_t id) const;
+  std::size_t column(double x) const;
+  std::size_t row(double y) const;
+
+  template <typename Visit>
+  void rasterize(std::size_t id, Visit visit) const;
+
+ public:
+  WallGrid(const WallSet &walls, const Box &field);
+
+  void add(std::size_t id);
+  std::size_t unplaced_count() const;
+
+  /**
+   * @brief Collects the walls which may hold the nearest intersection of the
+   * ray and intersects them with it.
+   *
+   * @param ray The ray, starting at the casting point.
+   * @param query The buffers receiving the candidates.
+   * @return False if a candidate which is not a zero-length wall gives a
+   * NaN intersection; the grid cannot order those, so the caller has to test
+   * the ray against every wall.
+   */
+  bool cast_ray(const Wall &ray, Query &query) const;
+};
+
+}  // namespace Treasure_Hunt
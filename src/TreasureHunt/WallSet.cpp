@@ -0,0 +1,721 @@
+#include "WallSet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Length of the Ox wall the slopes of the walls are compared against
+#define OX_LENGTH 100
+
+// Largest absolute value of the integer coordinates handled exactly
+#define EXACT_COORDINATE_LIMIT 256
+
+// Bound of the relative error of the single precision intersection terms,
+// 8 units in the last place of a float; it also covers the error of the
+// double precision terms they are compared with
+#define FLOAT_TERM_ERROR 0x1p-21f
+
+// Relative and absolute slack added to the bounds of the single precision
+// intersection points, for the rounding of the bounds themselves
+#define FLOAT_POINT_SLACK 0x1p-20f
+#define FLOAT_ABSOLUTE_SLACK 0x1p-100f
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TREASURE_HUNT_AVX2
+#include <immintrin.h>
+#endif
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Precomputes the coefficients of the line through the wall.
+ *
+ * @param wall The wall.
+ *
+ * The parallel key is the cosine computed by Wall::is_parallel: the lengths
+ * of the projections of the wall and of Ox on the axes are combined exactly
+ * as there, so comparing the keys gives the same answer.
+ */
+LineCoefficients::LineCoefficients(const Wall &wall)
+    : dx(wall.x1() - wall.x2()),
+      dy(wall.y1() - wall.y2()),
+      cross(wall.x1() * wall.y2() - wall.y1() * wall.x2()) {
+  double dx_abs = std::abs(wall.x2() - wall.x1());
+  double dy_abs = std::abs(wall.y2() - wall.y1());
+  double dOx = OX_LENGTH;
+  double dOy = 0;
+
+  parallel_key =
+      (dx_abs * dOx + dy_abs * dOy) / (dx_abs * dx_abs + dy_abs * dy_abs);
+}
+
+/**
+ * @brief Calculates the intersection point of two lines.
+ *
+ * @param line1 The first line.
+ * @param line2 The second line.
+ * @return The intersection point, NaN values if the lines are parallel.
+ *
+ * This is the parametric line equation of Wall::intersection_point with the
+ * per-line products already computed.
+ */
+Point LineCoefficients::intersection_point(const LineCoefficients &line1,
+                                           const LineCoefficients &line2) {
+  if (line1.parallel_key == line2.parallel_key) {
+    return Point(std::numeric_limits<double>::quiet_NaN(),
+                 std::numeric_limits<double>::quiet_NaN());
+  }
+
+  double denominator = line1.dx * line2.dy - line1.dy * line2.dx;
+  return Point((line1.cross * line2.dx - line1.dx * line2.cross) / denominator,
+               (line1.cross * line2.dy - line1.dy * line2.cross) / denominator);
+}
+
+/**
+ * @brief Converts the integer coefficients of the line through the wall.
+ *
+ * @param wall The wall; its coordinates must be exact integers.
+ */
+ExactLineCoefficients::ExactLineCoefficients(const Wall &wall) {
+  auto x1 = static_cast<std::int64_t>(wall.x1());
+  auto y1 = static_cast<std::int64_t>(wall.y1());
+  auto x2 = static_cast<std::int64_t>(wall.x2());
+  auto y2 = static_cast<std::int64_t>(wall.y2());
+
+  dx = x1 - x2;
+  dy = y1 - y2;
+  cross = x1 * y2 - y1 * x2;
+  dx_abs = dx < 0 ? -dx : dx;
+  squared_length = dx * dx + dy * dy;
+}
+
+/**
+ * @brief Checks if a coordinate can be handled by the exact predicates.
+ */
+static bool is_exact_coordinate(double value) {
+  return std::abs(value) <= EXACT_COORDINATE_LIMIT &&
+         value == std::floor(value);
+}
+
+#if defined(TREASURE_HUNT_AVX2) || defined(TREASURE_HUNT_FLOAT_SCREEN)
+
+/**
+ * @brief Rounds a double to the nearest float, or to an infinity if it is
+ * out of the range of floats.
+ */
+static float round_to_float(double value) {
+  if (value > std::numeric_limits<float>::max()) {
+    return std::numeric_limits<float>::infinity();
+  }
+  if (value < -std::numeric_limits<float>::max()) {
+    return -std::numeric_limits<float>::infinity();
+  }
+  return static_cast<float>(value);
+}
+
+#endif
+
+#ifdef TREASURE_HUNT_AVX2
+
+/**
+ * @brief Rounds a bound of a box to a float at least FLOAT_POINT_SLACK
+ * farther out, so that a float beyond it is beyond the bound itself.
+ */
+static float round_bound_to_float(double bound, bool upper) {
+  double slack = std::abs(bound) * FLOAT_POINT_SLACK;
+  return round_to_float(upper ? bound + slack : bound - slack);
+}
+
+/**
+ * @brief Checks once whether the processor supports AVX2.
+ */
+static bool avx2_supported() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+/**
+ * @brief Absolute values of eight floats.
+ */
+__attribute__((target("avx2"), always_inline)) static inline __m256 abs_ps(
+    __m256 value) {
+  return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+}
+
+/**
+ * @brief Bound of the error of the single precision term a * b - c * d with
+ * the given absolute values of its factors.
+ */
+__attribute__((target("avx2"), always_inline)) static inline __m256
+term_error_ps(__m256 a, __m256 b, __m256 c, __m256 d) {
+  __m256 magnitude = _mm256_add_ps(_mm256_mul_ps(a, b), _mm256_mul_ps(c, d));
+  __m256 error = _mm256_mul_ps(magnitude, _mm256_set1_ps(FLOAT_TERM_ERROR));
+  return _mm256_add_ps(error, _mm256_set1_ps(FLOAT_ABSOLUTE_SLACK));
+}
+
+/**
+ * @brief Bound of the error of the single precision quotient q = n / d.
+ *
+ * The denominator is at least twice its error e_d away from zero, so the
+ * quotient is off by less than 2 * (e_n + |q| * e_d) / |d|; the factor 2.5
+ * and the slacks absorb the rounding of q and of the bound itself.
+ */
+__attribute__((target("avx2"), always_inline)) static inline __m256
+quotient_error_ps(__m256 quotient, __m256 numerator_error,
+                  __m256 denominator_error, __m256 inverse_abs) {
+  __m256 quotient_abs = abs_ps(quotient);
+  __m256 error = _mm256_mul_ps(
+      _mm256_mul_ps(_mm256_set1_ps(2.5f), inverse_abs),
+      _mm256_add_ps(numerator_error,
+                    _mm256_mul_ps(quotient_abs, denominator_error)));
+  error = _mm256_add_ps(
+      error, _mm256_mul_ps(quotient_abs, _mm256_set1_ps(FLOAT_POINT_SLACK)));
+  return _mm256_add_ps(error, _mm256_set1_ps(FLOAT_ABSOLUTE_SLACK));
+}
+
+/**
+ * @brief A ray prepared for screen_ray_avx2: its line coefficients rounded
+ * to floats, their absolute values, and the box an intersection must lie in
+ * to be kept (the field and the bounding box of the ray together), rounded
+ * outwards.
+ */
+struct FloatRay {
+  __m256 dx, dy, cross;
+  __m256 dx_abs, dy_abs, cross_abs;
+  __m256 x_min, x_max, y_min, y_max;
+};
+
+/**
+ * @brief Finds the walls whose intersection with a ray is certainly rejected
+ * by WallSet::cast_ray, eight walls at a time in single precision.
+ *
+ * @param dx, dy, cross The line coefficients of the walls rounded to floats.
+ * @param ray The ray.
+ * @return A mask with bit k set if the wall k is certainly rejected.
+ *
+ * The numerators and the denominator of the intersection are computed in
+ * floats together with a bound of their distance to the double precision
+ * ones, FLOAT_TERM_ERROR times the sum of the magnitudes of their products.
+ * When the denominator is farther from zero than twice its error, the
+ * quotient is bounded as well, and a wall is rejected only if the whole
+ * interval around its point lies out of the box. The remaining walls,
+ * near-degenerate or close to the box, are left to the double precision
+ * test, so the result never differs from it. Infinities and NaN make every
+ * comparison false and leave the walls to it as well.
+ */
+__attribute__((target("avx2"), always_inline)) static inline int
+screen_ray_avx2(const float *dx, const float *dy, const float *cross,
+                const FloatRay &ray) {
+  __m256 wall_dx = _mm256_loadu_ps(dx);
+  __m256 wall_dy = _mm256_loadu_ps(dy);
+  __m256 wall_cross = _mm256_loadu_ps(cross);
+  __m256 wall_dx_abs = abs_ps(wall_dx);
+  __m256 wall_dy_abs = abs_ps(wall_dy);
+  __m256 wall_cross_abs = abs_ps(wall_cross);
+
+  // The terms of the intersection and the bounds of their errors
+  __m256 denominator = _mm256_sub_ps(_mm256_mul_ps(wall_dx, ray.dy),
+                                     _mm256_mul_ps(wall_dy, ray.dx));
+  __m256 x_numerator = _mm256_sub_ps(_mm256_mul_ps(wall_cross, ray.dx),
+                                     _mm256_mul_ps(wall_dx, ray.cross));
+  __m256 y_numerator = _mm256_sub_ps(_mm256_mul_ps(wall_cross, ray.dy),
+                                     _mm256_mul_ps(wall_dy, ray.cross));
+  __m256 denominator_error =
+      term_error_ps(wall_dx_abs, ray.dy_abs, wall_dy_abs, ray.dx_abs);
+  __m256 x_numerator_error =
+      term_error_ps(wall_cross_abs, ray.dx_abs, wall_dx_abs, ray.cross_abs);
+  __m256 y_numerator_error =
+      term_error_ps(wall_cross_abs, ray.dy_abs, wall_dy_abs, ray.cross_abs);
+
+  // The intersection point and the bounds of its error
+  __m256 certain = _mm256_cmp_ps(
+      abs_ps(denominator), _mm256_add_ps(denominator_error, denominator_error),
+      _CMP_GT_OQ);
+  __m256 inverse = _mm256_div_ps(_mm256_set1_ps(1.0f), denominator);
+  __m256 inverse_abs = abs_ps(inverse);
+  __m256 x = _mm256_mul_ps(x_numerator, inverse);
+  __m256 y = _mm256_mul_ps(y_numerator, inverse);
+  __m256 x_error =
+      quotient_error_ps(x, x_numerator_error, denominator_error, inverse_abs);
+  __m256 y_error =
+      quotient_error_ps(y, y_numerator_error, denominator_error, inverse_abs);
+
+  __m256 outside =
+      _mm256_cmp_ps(_mm256_add_ps(x, x_error), ray.x_min, _CMP_LT_OQ);
+  outside = _mm256_or_ps(
+      outside, _mm256_cmp_ps(_mm256_sub_ps(x, x_error), ray.x_max, _CMP_GT_OQ));
+  outside = _mm256_or_ps(
+      outside, _mm256_cmp_ps(_mm256_add_ps(y, y_error), ray.y_min, _CMP_LT_OQ));
+  outside = _mm256_or_ps(
+      outside, _mm256_cmp_ps(_mm256_sub_ps(y, y_error), ray.y_max, _CMP_GT_OQ));
+
+  return _mm256_movemask_ps(_mm256_and_ps(certain, outside));
+}
+
+/**
+ * @brief AVX2 version of WallSet::cast_ray for four walls at a time.
+ *
+ * @tparam kGather Whether the walls are given by ids or are the first count
+ * walls of the set.
+ * @tparam kScreen Whether the walls are screened eight at a time by
+ * screen_ray_avx2 first; four walls it rejects are marked as not kept
+ * without computing their points. Only without ids.
+ * @param float_dx, float_dy, float_cross The coefficients rounded to floats,
+ * for the screen.
+ * @return The number of walls processed; the rest is left to the caller.
+ */
+template <bool kGather, bool kScreen>
+__attribute__((target("avx2"))) static std::size_t cast_ray_avx2(
+    const double *dx, const double *dy, const double *cross,
+    const double *parallel_key, const float *float_dx, const float *float_dy,
+    const float *float_cross, const std::size_t *ids, std::size_t count,
+    const LineCoefficients &ray, const Box &ray_box, const Box &field,
+    double *px, double *py, unsigned char *kept) {
+  const __m256d ray_dx = _mm256_set1_pd(ray.dx);
+  const __m256d ray_dy = _mm256_set1_pd(ray.dy);
+  const __m256d ray_cross = _mm256_set1_pd(ray.cross);
+  const __m256d ray_key = _mm256_set1_pd(ray.parallel_key);
+
+  const __m256d field_x_min = _mm256_set1_pd(field.x_min);
+  const __m256d field_x_max = _mm256_set1_pd(field.x_max);
+  const __m256d field_y_min = _mm256_set1_pd(field.y_min);
+  const __m256d field_y_max = _mm256_set1_pd(field.y_max);
+  const __m256d ray_x_min = _mm256_set1_pd(ray_box.x_min);
+  const __m256d ray_x_max = _mm256_set1_pd(ray_box.x_max);
+  const __m256d ray_y_min = _mm256_set1_pd(ray_box.y_min);
+  const __m256d ray_y_max = _mm256_set1_pd(ray_box.y_max);
+
+  FloatRay float_ray;
+  if constexpr (kScreen) {
+    float_ray.dx = _mm256_set1_ps(round_to_float(ray.dx));
+    float_ray.dy = _mm256_set1_ps(round_to_float(ray.dy));
+    float_ray.cross = _mm256_set1_ps(round_to_float(ray.cross));
+    float_ray.dx_abs = abs_ps(float_ray.dx);
+    float_ray.dy_abs = abs_ps(float_ray.dy);
+    float_ray.cross_abs = abs_ps(float_ray.cross);
+    float_ray.x_min = _mm256_set1_ps(
+        round_bound_to_float(std::max(field.x_min, ray_box.x_min), false));
+    float_ray.x_max = _mm256_set1_ps(
+        round_bound_to_float(std::min(field.x_max, ray_box.x_max), true));
+    float_ray.y_min = _mm256_set1_ps(
+        round_bound_to_float(std::max(field.y_min, ray_box.y_min), false));
+    float_ray.y_max = _mm256_set1_ps(
+        round_bound_to_float(std::min(field.y_max, ray_box.y_max), true));
+  }
+
+  std::size_t i = 0;
+  int rejected = 0;
+  for (; i + 4 <= count; i += 4) {
+    if constexpr (kScreen) {
+      // Screen the next eight walls, and skip four walls rejected together
+      if (i % 8 == 0) {
+        rejected = i + 8 <= count ? screen_ray_avx2(float_dx + i, float_dy + i,
+                                                    float_cross + i, float_ray)
+                                  : 0;
+      } else {
+        rejected >>= 4;
+      }
+      if ((rejected & 15) == 15) {
+        for (std::size_t lane = 0; lane < 4; lane++) {
+          kept[i + lane] = 0;
+        }
+        continue;
+      }
+    }
+
+    __m256d wall_dx, wall_dy, wall_cross, wall_key;
+    if constexpr (kGather) {
+      __m256i index =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ids + i));
+      wall_dx = _mm256_i64gather_pd(dx, index, 8);
+      wall_dy = _mm256_i64gather_pd(dy, index, 8);
+      wall_cross = _mm256_i64gather_pd(cross, index, 8);
+      wall_key = _mm256_i64gather_pd(parallel_key, index, 8);
+    } else {
+      wall_dx = _mm256_loadu_pd(dx + i);
+      wall_dy = _mm256_loadu_pd(dy + i);
+      wall_cross = _mm256_loadu_pd(cross + i);
+      wall_key = _mm256_loadu_pd(parallel_key + i);
+    }
+
+    // The wall is the first line of the intersection and the ray the second
+    __m256d denominator = _mm256_sub_pd(_mm256_mul_pd(wall_dx, ray_dy),
+                                        _mm256_mul_pd(wall_dy, ray_dx));
+    __m256d x = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(wall_cross, ray_dx),
+                                            _mm256_mul_pd(wall_dx, ray_cross)),
+                              denominator);
+    __m256d y = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(wall_cross, ray_dy),
+                                            _mm256_mul_pd(wall_dy, ray_cross)),
+                              denominator);
+
+    // Ordered comparisons are false for NaN, as the scalar ones are
+    __m256d reject = _mm256_cmp_pd(wall_key, ray_key, _CMP_EQ_OQ);
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(x, field_x_min, _CMP_LT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(x, field_x_max, _CMP_GT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(y, field_y_min, _CMP_LT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(y, field_y_max, _CMP_GT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(x, ray_x_min, _CMP_LT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(x, ray_x_max, _CMP_GT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(y, ray_y_min, _CMP_LT_OQ));
+    reject = _mm256_or_pd(reject, _mm256_cmp_pd(y, ray_y_max, _CMP_GT_OQ));
+
+    _mm256_storeu_pd(px + i, x);
+    _mm256_storeu_pd(py + i, y);
+    int mask = _mm256_movemask_pd(reject);
+    for (std::size_t lane = 0; lane < 4; lane++) {
+      kept[i + lane] = !((mask >> lane) & 1);
+    }
+  }
+
+  return i;
+}
+
+/**
+ * @brief AVX2 version of WallSet::intersect_line for four walls at a time.
+ *
+ * @return The number of walls processed; the rest is left to the caller.
+ */
+__attribute__((target("avx2"))) static std::size_t intersect_line_avx2(
+    const double *dx, const double *dy, const double *cross,
+    const double *parallel_key, const LineCoefficients &line,
+    const std::size_t *ids, std::size_t count, double *px, double *py) {
+  const __m256d line_dx = _mm256_set1_pd(line.dx);
+  const __m256d line_dy = _mm256_set1_pd(line.dy);
+  const __m256d line_cross = _mm256_set1_pd(line.cross);
+  const __m256d line_key = _mm256_set1_pd(line.parallel_key);
+  const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i index =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ids + i));
+    __m256d wall_dx = _mm256_i64gather_pd(dx, index, 8);
+    __m256d wall_dy = _mm256_i64gather_pd(dy, index, 8);
+    __m256d wall_cross = _mm256_i64gather_pd(cross, index, 8);
+    __m256d wall_key = _mm256_i64gather_pd(parallel_key, index, 8);
+
+    // The line is the first line of the intersection and the wall the second
+    __m256d denominator = _mm256_sub_pd(_mm256_mul_pd(line_dx, wall_dy),
+                                        _mm256_mul_pd(line_dy, wall_dx));
+    __m256d x = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(line_cross, wall_dx),
+                                            _mm256_mul_pd(line_dx, wall_cross)),
+                              denominator);
+    __m256d y = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(line_cross, wall_dy),
+                                            _mm256_mul_pd(line_dy, wall_cross)),
+                              denominator);
+
+    __m256d parallel = _mm256_cmp_pd(wall_key, line_key, _CMP_EQ_OQ);
+    _mm256_storeu_pd(px + i, _mm256_blendv_pd(x, nan, parallel));
+    _mm256_storeu_pd(py + i, _mm256_blendv_pd(y, nan, parallel));
+  }
+
+  return i;
+}
+
+#endif
+
+WallSet::WallSet() { append(Wall(0, 0, 0, 0)); }
+
+WallSet::WallSet(const std::vector<Wall> &walls) {
+  for (const auto &wall : walls) {
+    append(wall);
+  }
+  // The zero wall reported by ray_casting for degenerate rays
+  append(Wall(0, 0, 0, 0));
+}
+
+void WallSet::append(const Wall &wall) {
+  LineCoefficients line(wall);
+
+  exact_ = exact_ && is_exact_coordinate(wall.x1()) &&
+           is_exact_coordinate(wall.y1()) && is_exact_coordinate(wall.x2()) &&
+           is_exact_coordinate(wall.y2());
+  if (exact_) {
+    exact_lines_.push_back(ExactLineCoefficients(wall));
+  } else {
+    exact_lines_.clear();
+  }
+
+  x1_.push_back(wall.x1());
+  y1_.push_back(wall.y1());
+  x2_.push_back(wall.x2());
+  y2_.push_back(wall.y2());
+  dx_.push_back(line.dx);
+  dy_.push_back(line.dy);
+  cross_.push_back(line.cross);
+  parallel_key_.push_back(line.parallel_key);
+#ifdef TREASURE_HUNT_FLOAT_SCREEN
+  float_dx_.push_back(round_to_float(line.dx));
+  float_dy_.push_back(round_to_float(line.dy));
+  float_cross_.push_back(round_to_float(line.cross));
+#endif
+  removed_.push_back(0);
+}
+
+/**
+ * @brief Drops the last slot, which must not be a removed wall.
+ */
+void WallSet::pop() {
+  x1_.pop_back();
+  y1_.pop_back();
+  x2_.pop_back();
+  y2_.pop_back();
+  dx_.pop_back();
+  dy_.pop_back();
+  cross_.pop_back();
+  parallel_key_.pop_back();
+#ifdef TREASURE_HUNT_FLOAT_SCREEN
+  float_dx_.pop_back();
+  float_dy_.pop_back();
+  float_cross_.pop_back();
+#endif
+  removed_.pop_back();
+  if (exact_) {
+    exact_lines_.pop_back();
+  }
+}
+
+std::size_t WallSet::size() const { return x1_.size() - 1; }
+
+/**
+ * @brief Adds a wall behind the others.
+ *
+ * @param wall The wall.
+ * @return The id of the wall, the previous size().
+ */
+std::size_t WallSet::add(const Wall &wall) {
+  std::size_t id = size();
+  pop();
+  append(wall);
+  append(Wall(0, 0, 0, 0));
+  return id;
+}
+
+/**
+ * @brief Removes the wall with the given id, which keeps its slot.
+ */
+void WallSet::remove(std::size_t id) {
+  if (!removed_[id]) {
+    removed_[id] = 1;
+    removed_count_++;
+  }
+}
+
+bool WallSet::removed(std::size_t id) const { return removed_[id]; }
+
+Wall WallSet::wall(std::size_t id) const {
+  return Wall(x1_[id], y1_[id], x2_[id], y2_[id]);
+}
+
+LineCoefficients WallSet::line(std::size_t id) const {
+  LineCoefficients line;
+  line.dx = dx_[id];
+  line.dy = dy_[id];
+  line.cross = cross_[id];
+  line.parallel_key = parallel_key_[id];
+  return line;
+}
+
+/**
+ * @brief Checks if the intersections of the walls inside the field can be
+ * decided exactly.
+ */
+bool WallSet::exact_in(const Box &field) const {
+  return exact_ && is_exact_coordinate(field.x_min) &&
+         is_exact_coordinate(field.y_min) &&
+         is_exact_coordinate(field.x_max) && is_exact_coordinate(field.y_max);
+}
+
+bool WallSet::is_parallel(std::size_t id1, std::size_t id2) const {
+  return parallel_key_[id1] == parallel_key_[id2];
+}
+
+/**
+ * @brief Intersects a ray with every wall of the set.
+ *
+ * A wall is kept when its intersection with the ray is neither out of the
+ * field nor beyond the ends of the ray, and the wall is not parallel to the
+ * ray. Four walls are processed per AVX2 instruction when it is available,
+ * the rest is done one by one with the same arithmetic.
+ *
+ * With TREASURE_HUNT_FLOAT_SCREEN the walls are first screened eight at a
+ * time in single precision, and the double precision points are only
+ * computed for the walls the screen cannot reject for certain; the points of
+ * the walls which are not kept are then left undefined. The screen pays off
+ * where double division is slow and most walls miss the ray, so it is off by
+ * default; the TreasureHunt_float_screen library is always built with it and
+ * tested against the same expectations.
+ */
+void WallSet::cast_ray(const Wall &ray, const Box &field, double *px,
+                       double *py, unsigned char *kept) const {
+  cast_ray(ray, field, nullptr, size(), px, py, kept);
+}
+
+/**
+ * @brief Intersects a ray with the walls with the given ids.
+ *
+ * Works as the version for the whole set; the results for ids[i] are stored
+ * at index i. Without ids the first count walls are intersected.
+ */
+void WallSet::cast_ray(const Wall &ray, const Box &field,
+                       const std::size_t *ids, std::size_t count, double *px,
+                       double *py, unsigned char *kept) const {
+  LineCoefficients ray_line(ray);
+  Box ray_box{std::min(ray.x1(), ray.x2()), std::min(ray.y1(), ray.y2()),
+              std::max(ray.x1(), ray.x2()), std::max(ray.y1(), ray.y2())};
+
+  std::size_t i = 0;
+#ifdef TREASURE_HUNT_AVX2
+  if (avx2_supported()) {
+    i = ids ? cast_ray_avx2<true, false>(
+                  dx_.data(), dy_.data(), cross_.data(), parallel_key_.data(),
+                  nullptr, nullptr, nullptr, ids, count, ray_line, ray_box,
+                  field, px, py, kept)
+#ifdef TREASURE_HUNT_FLOAT_SCREEN
+            : cast_ray_avx2<false, true>(
+                  dx_.data(), dy_.data(), cross_.data(), parallel_key_.data(),
+                  float_dx_.data(), float_dy_.data(), float_cross_.data(),
+                  nullptr, count, ray_line, ray_box, field, px, py, kept);
+#else
+            : cast_ray_avx2<false, false>(
+                  dx_.data(), dy_.data(), cross_.data(), parallel_key_.data(),
+                  nullptr, nullptr, nullptr, nullptr, count, ray_line, ray_box,
+                  field, px, py, kept);
+#endif
+  }
+#endif
+
+  for (; i < count; i++) {
+    std::size_t id = ids ? ids[i] : i;
+    bool parallel = parallel_key_[id] == ray_line.parallel_key;
+    double denominator = dx_[id] * ray_line.dy - dy_[id] * ray_line.dx;
+    double x =
+        (cross_[id] * ray_line.dx - dx_[id] * ray_line.cross) / denominator;
+    double y =
+        (cross_[id] * ray_line.dy - dy_[id] * ray_line.cross) / denominator;
+
+    bool out_of_field = x < field.x_min || x > field.x_max ||
+                        y < field.y_min || y > field.y_max;
+    bool beyond_ray = x < ray_box.x_min || x > ray_box.x_max ||
+                      y < ray_box.y_min || y > ray_box.y_max;
+
+    px[i] = x;
+    py[i] = y;
+    kept[i] = !(parallel || out_of_field || beyond_ray);
+  }
+
+  if (removed_count_ != 0) {
+    for (i = 0; i < count; i++) {
+      kept[i] = kept[i] && !removed_[ids ? ids[i] : i];
+    }
+  }
+}
+
+/**
+ * @brief Intersects a line with the walls with the given ids.
+ *
+ * The result for every wall is the one of
+ * Wall::intersection_point(line, wall). Four walls are processed per AVX2
+ * instruction when it is available.
+ */
+void WallSet::intersect_line(const LineCoefficients &line,
+                             const std::size_t *ids, std::size_t count,
+                             double *px, double *py) const {
+  std::size_t i = 0;
+#ifdef TREASURE_HUNT_AVX2
+  if (avx2_supported()) {
+    i = intersect_line_avx2(dx_.data(), dy_.data(), cross_.data(),
+                            parallel_key_.data(), line, ids, count, px, py);
+  }
+#endif
+
+  for (; i < count; i++) {
+    auto point = LineCoefficients::intersection_point(line, this->line(ids[i]));
+    px[i] = point.x();
+    py[i] = point.y();
+  }
+}
+
+/**
+ * @brief Intersects the line through a wall of the set with the walls with
+ * the given ids.
+ *
+ * The points are the ones of Wall::intersection_point(wall, ids[i]). With
+ * integer coordinates up to EXACT_COORDINATE_LIMIT, they are decided on the
+ * integer coefficients instead:
+ *
+ *  - the slopes are compared by cross-multiplying the parallel keys,
+ *    |dx1| * length2^2 == |dx2| * length1^2;
+ *  - an intersection is the rational (nx / d, ny / d), tested against the
+ *    field by integer comparisons, and only converted when it is kept.
+ *
+ * Within the limit the numerators and the denominators are exact in double
+ * as well, and two different rationals in the field are farther apart than
+ * the rounding, so the results are the same as with double arithmetic, while
+ * the same point reached from different pairs of walls always gives the same
+ * double.
+ */
+void WallSet::intersect_walls(std::size_t id, const std::size_t *ids,
+                              std::size_t count, const Box &field, double *px,
+                              double *py, unsigned char *kept) const {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  if (!exact_in(field)) {
+    intersect_line(line(id), ids, count, px, py);
+    for (std::size_t i = 0; i < count; i++) {
+      bool parallel = is_parallel(id, ids[i]);
+      bool out_of_field = px[i] < field.x_min || px[i] > field.x_max ||
+                          py[i] < field.y_min || py[i] > field.y_max;
+      kept[i] = !(parallel || out_of_field);
+    }
+    return;
+  }
+
+  auto x_min = static_cast<std::int64_t>(field.x_min);
+  auto y_min = static_cast<std::int64_t>(field.y_min);
+  auto x_max = static_cast<std::int64_t>(field.x_max);
+  auto y_max = static_cast<std::int64_t>(field.y_max);
+
+  const auto &line1 = exact_lines_[id];
+  for (std::size_t i = 0; i < count; i++) {
+    const auto &line2 = exact_lines_[ids[i]];
+    px[i] = py[i] = nan;
+
+    // Zero walls have no parallel key and are never parallel
+    bool parallel = line1.squared_length != 0 && line2.squared_length != 0 &&
+                    line1.dx_abs * line2.squared_length ==
+                        line2.dx_abs * line1.squared_length;
+    if (parallel) {
+      kept[i] = 0;
+      continue;
+    }
+
+    std::int64_t d = line1.dx * line2.dy - line1.dy * line2.dx;
+    std::int64_t nx = line1.cross * line2.dx - line1.dx * line2.cross;
+    std::int64_t ny = line1.cross * line2.dy - line1.dy * line2.cross;
+
+    // Walls on parallel lines with different parallel keys: the division by
+    // zero gives an infinite coordinate, out of the field, unless both
+    // numerators are zero and the point is not a number
+    if (d == 0) {
+      kept[i] = nx == 0 && ny == 0;
+      continue;
+    }
+
+    // Compare nx / d and ny / d with the field bounds by multiplying by d
+    if (d < 0) {
+      d = -d;
+      nx = -nx;
+      ny = -ny;
+    }
+    bool out_of_field = nx < x_min * d || nx > x_max * d || ny < y_min * d ||
+                        ny > y_max * d;
+    kept[i] = !out_of_field;
+    if (!out_of_field) {
+      px[i] = static_cast<double>(nx) / static_cast<double>(d);
+      py[i] = static_cast<double>(ny) / static_cast<double>(d);
+    }
+  }
+}
+
+}  // namespace Treasure_Hunt
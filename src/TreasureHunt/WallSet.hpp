@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TreasureHunt.hpp"
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Coefficients of the line through a wall, as used by
+ * Wall::intersection_point and Wall::is_parallel.
+ */
+struct LineCoefficients {
+  double dx;            // x1 - x2
+  double dy;            // y1 - y2
+  double cross;         // x1 * y2 - y1 * x2
+  double parallel_key;  // the cosine with Ox compared by Wall::is_parallel
+
+  LineCoefficients() = default;
+  explicit LineCoefficients(const Wall &wall);
+
+  static Point intersection_point(const LineCoefficients &line1,
+                                  const LineCoefficients &line2);
+};
+
+/**
+ * @brief Integer coefficients of the line through a wall with integer
+ * coordinates, as used by the exact predicates of WallSet.
+ */
+struct ExactLineCoefficients {
+  std::int64_t dx;              // x1 - x2
+  std::int64_t dy;              // y1 - y2
+  std::int64_t cross;           // x1 * y2 - y1 * x2
+  std::int64_t dx_abs;          // |x2 - x1|
+  std::int64_t squared_length;  // dx * dx + dy * dy
+
+  ExactLineCoefficients() = default;
+  explicit ExactLineCoefficients(const Wall &wall);
+};
+
+/**
+ * @brief Structure-of-arrays storage of walls.
+ *
+ * Every wall keeps its coordinates together with the coefficients of its
+ * line, so the batch kernels below can intersect one ray or segment with
+ * several walls per instruction. The kernels give bit-for-bit the same
+ * results as Wall::intersection_point and Wall::is_parallel.
+ *
+ * One more slot with a zero wall is kept behind the last wall. It has the id
+ * size() and stands for the zero wall which ray_casting reports for
+ * degenerate rays; ray casting never tests against it.
+ *
+ * Walls can be added and removed after construction. Ids are never reused:
+ * an added wall takes the next id (the zero wall moves behind it) and a
+ * removed wall keeps its slot but is never kept by cast_ray.
+ *
+ * When every coordinate is a small integer, the walls also keep the integer
+ * coefficients of their lines, and the intersections between walls are
+ * decided exactly on them (see intersect_walls).
+ */
+class WallSet {
+ private:
+  std::vector<double> x1_, y1_, x2_, y2_;
+  std::vector<double> dx_, dy_, cross_, parallel_key_;
+#ifdef TREASURE_HUNT_FLOAT_SCREEN
+  // Line coefficients rounded to floats, for the single precision screen
+  std::vector<float> float_dx_, float_dy_, float_cross_;
+#endif
+
+  // Integer coefficients, only filled if every wall is exact
+  std::vector<ExactLineCoefficients> exact_lines_;
+  bool exact_ = true;
+
+  std::vector<unsigned char> removed_;
+  std::size_t removed_count_ = 0;
+
+  void append(const Wall &wall);
+  void pop();
+  bool exact_in(const Box &field) const;
+
+ public:
+  WallSet();
+  explicit WallSet(const std::vector<Wall> &walls);
+
+  std::size_t size() const;
+
+  std::size_t add(const Wall &wall);
+  void remove(std::size_t id);
+  bool removed(std::size_t id) const;
+
+  Wall wall(std::size_t id) const;
+  LineCoefficients line(std::size_t id) const;
+
+  bool is_parallel(std::size_t id1, std::size_t id2) const;
+
+  /**
+   * @brief Intersects a ray with every wall of the set.
+   *
+   * @param ray The ray; it is the second argument of the intersection.
+   * @param field The field box.
+   * @param px, py Receive the intersection points, size() values each;
+   * only the points of the kept walls are defined.
+   * @param kept Receives 1 for the walls whose intersection lies in the field
+   * and on the ray and 0 for the others (parallel and removed walls
+   * included).
+   */
+  void cast_ray(const Wall &ray, const Box &field, double *px, double *py,
+                unsigned char *kept) const;
+  void cast_ray(const Wall &ray, const Box &field, const std::size_t *ids,
+                std::size_t count, double *px, double *py,
+                unsigned char *kept) const;
+
+  /**
+   * @brief Intersects a line with the walls with the given ids.
+   *
+   * @param line The line; it is the first argument of the intersection.
+   * @param ids, count The ids of the walls, which may include size().
+   * @param px, py Receive the intersection points, NaN for parallel walls.
+   */
+  void intersect_line(const LineCoefficients &line, const std::size_t *ids,
+                      std::size_t count, double *px, double *py) const;
+
+  /**
+   * @brief Intersects the line through a wall of the set with the walls with
+   * the given ids.
+   *
+   * @param id The id of the wall; it is the first argument of the
+   * intersection.
+   * @param ids, count The ids of the walls, which may include size().
+   * @param field The field box.
+   * @param px, py Receive the intersection points.
+   * @param kept Receives 1 for the walls which are not parallel to the wall
+   * and whose intersection is not out of the field, 0 for the others.
+   */
+  void intersect_walls(std::size_t id, const std::size_t *ids,
+                       std::size_t count, const Box &field, double *px,
+                       double *py, unsigned char *kept) const;
+};
+
+}  // namespace Treasure_Hunt
@@ -0,0 +1,167 @@
+#include "WorkStealingPool.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace Treasure_Hunt {
+
+static std::uint64_t pack(std::uint64_t begin, std::uint64_t end) {
+  return begin << 32 | end;
+}
+
+static std::uint64_t range_begin(std::uint64_t bounds) { return bounds >> 32; }
+
+static std::uint64_t range_end(std::uint64_t bounds) {
+  return bounds & 0xffffffffu;
+}
+
+/**
+ * @brief Starts the threads of the pool.
+ *
+ * @param worker_count The number of workers, the calling thread included;
+ * 0 stands for one per hardware thread.
+ */
+WorkStealingPool::WorkStealingPool(std::size_t worker_count) {
+  if (worker_count == 0) {
+    worker_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  worker_count_ = worker_count;
+  ranges_ = std::make_unique<Range[]>(worker_count_);
+
+  threads_.reserve(worker_count_ - 1);
+  for (std::size_t worker = 1; worker < worker_count_; worker++) {
+    threads_.emplace_back(&WorkStealingPool::thread_loop, this, worker);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+std::size_t WorkStealingPool::size() const { return worker_count_; }
+
+/**
+ * @brief Takes the next index from the front of the range of the worker.
+ */
+bool WorkStealingPool::take(std::size_t worker, std::size_t &index) {
+  auto &bounds = ranges_[worker].bounds;
+  std::uint64_t current = bounds.load(std::memory_order_acquire);
+  while (range_begin(current) < range_end(current)) {
+    std::uint64_t next = pack(range_begin(current) + 1, range_end(current));
+    if (bounds.compare_exchange_weak(current, next,
+                                     std::memory_order_acq_rel)) {
+      index = range_begin(current);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Moves the back half of the range of another worker to the empty
+ * range of the worker.
+ *
+ * @return False if every other range is empty.
+ */
+bool WorkStealingPool::steal(std::size_t worker) {
+  for (std::size_t offset = 1; offset < worker_count_; offset++) {
+    auto &bounds = ranges_[(worker + offset) % worker_count_].bounds;
+    std::uint64_t current = bounds.load(std::memory_order_acquire);
+    while (range_begin(current) < range_end(current)) {
+      std::uint64_t begin = range_begin(current), end = range_end(current);
+      std::uint64_t middle = end - (end - begin + 1) / 2;
+      if (bounds.compare_exchange_weak(current, pack(begin, middle),
+                                       std::memory_order_acq_rel)) {
+        ranges_[worker].bounds.store(pack(middle, end),
+                                     std::memory_order_release);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Runs the current task until no worker has indices left.
+ */
+void WorkStealingPool::work(std::size_t worker) {
+  std::size_t index;
+  do {
+    while (take(worker, index)) {
+      try {
+        (*task_)(worker, index);
+      } catch (...) {
+        std::lock_guard lock(mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  } while (steal(worker));
+}
+
+void WorkStealingPool::thread_loop(std::size_t worker) {
+  std::uint64_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      start_.wait(lock, [&] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    work(worker);
+
+    {
+      std::lock_guard lock(mutex_);
+      busy_workers_--;
+    }
+    finish_.notify_one();
+  }
+}
+
+void WorkStealingPool::run(std::size_t count, const Task &task) {
+  if (count > std::numeric_limits<std::uint32_t>::max()) {
+    throw std::length_error("Too many tasks for the pool");
+  }
+
+  // Split the indices evenly between the workers
+  for (std::size_t worker = 0; worker < worker_count_; worker++) {
+    ranges_[worker].bounds.store(pack(count * worker / worker_count_,
+                                      count * (worker + 1) / worker_count_),
+                                 std::memory_order_relaxed);
+  }
+
+  {
+    std::lock_guard lock(mutex_);
+    task_ = &task;
+    error_ = nullptr;
+    busy_workers_ = worker_count_ - 1;
+    generation_++;
+  }
+  start_.notify_all();
+
+  work(0);
+
+  std::unique_lock lock(mutex_);
+  finish_.wait(lock, [&] { return busy_workers_ == 0; });
+  task_ = nullptr;
+  if (error_) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+}  // namespace Treasure_Hunt
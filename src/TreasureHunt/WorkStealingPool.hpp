@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Treasure_Hunt {
+
+/**
+ * @brief Fixed set of threads running loops over index ranges.
+ *
+ * Every run splits the indices evenly between the workers. A worker takes
+ * the indices of its own range from the front, and once it runs dry it
+ * steals the back half of the range of another worker, so uneven tasks are
+ * rebalanced without a shared queue. The calling thread takes part as the
+ * worker 0.
+ */
+class WorkStealingPool {
+ public:
+  using Task = std::function<void(std::size_t worker, std::size_t index)>;
+
+ private:
+  // Range of indices [begin, end) of a worker, packed as begin << 32 | end so
+  // that the owner and the thieves update it with one compare-and-swap
+  struct alignas(64) Range {
+    std::atomic<std::uint64_t> bounds{0};
+  };
+
+  std::unique_ptr<Range[]> ranges_;
+  std::size_t worker_count_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable start_, finish_;
+  const Task *task_ = nullptr;
+  std::uint64_t generation_ = 0;
+  std::size_t busy_workers_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+
+  bool take(std::size_t worker, std::size_t &index);
+  bool steal(std::size_t worker);
+  void work(std::size_t worker);
+  void thread_loop(std::size_t worker);
+
+ public:
+  explicit WorkStealingPool(std::size_t worker_count);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  std::size_t size() const;
+
+  /**
+   * @brief Calls task(worker, index) for every index in [0, count) and waits
+   * for all the calls to finish.
+   *
+   * A worker id is below size() and is never used by two calls at the same
+   * time, so it can select per-worker state. The first exception thrown by a
+   * call is rethrown once the others are done.
+   */
+  void run(std::size_t count, const Task &task);
+};
+
+}  // namespace Treasure_Hunt
@@ -1,11 +1,71 @@
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+
+#include "SearchStatistics.hpp"
 #include "TreasureHunt.hpp"
 
-int main() {
-  try{
-  std::cout << Treasure_Hunt::handle_treasure_hunt(std::cin);
+/**
+ * @brief Reads a non-negative decimal number from the whole argument.
+ */
+static bool parse_count(const char *argument, std::size_t &count) {
+  if (!std::isdigit(static_cast<unsigned char>(*argument))) {
+    return false;
+  }
+  char *end = nullptr;
+  count = std::strtoul(argument, &end, 10);
+  return *end == '\0';
+}
+
+/**
+ * @brief Entry point for the TreasureHunt program.
+ *
+ * Reads the field from the standard input and prints the number of doors to
+ * the standard output. With --stats the work done by the search is printed
+ * to the standard error, and with --trace <file> it is written to the file
+ * as JSON. --threads <n> runs the search on n threads, one per hardware
+ * thread if n is 0.
+ */
+int main(int argc, char **argv) {
+  bool print_statistics = false;
+  const char *trace_file = nullptr;
+  Treasure_Hunt::FieldConfig config;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--stats") == 0) {
+      print_statistics = true;
+    } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_file = argv[++i];
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc &&
+               parse_count(argv[i + 1], config.thread_count)) {
+      i++;
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--stats] [--trace <file>] [--threads <n>]" << std::endl;
+      return 1;
+    }
+  }
+
+  try {
+    Treasure_Hunt::SearchStatistics statistics;
+    bool instrumented = print_statistics || trace_file;
+    std::cout << Treasure_Hunt::handle_treasure_hunt(
+        std::cin, config, instrumented ? &statistics : nullptr);
+
+    if (print_statistics) {
+      std::cerr << statistics;
+    }
+    if (trace_file) {
+      std::ofstream trace(trace_file);
+      if (!trace.is_open()) {
+        std::cerr << "Failed to open trace file: " << trace_file << std::endl;
+        return 1;
+      }
+      statistics.write_json(trace);
+    }
   } catch (const std::exception &e) {
     std::cerr << e.what() << std::endl;
   }
   return 0;
-}
\ No newline at end of file
+}
@@ -1,29 +1,598 @@
 #include <gtest/gtest.h>
 
+#include <RGBGame/BatchGame.hpp>
+#include <RGBGame/Bitboard.hpp>
+#include <RGBGame/GameSession.hpp>
 #include <RGBGame/RGBGame.hpp>
+#include <RGBGame/Search.hpp>
+#include <RGBGame/TranspositionTable.hpp>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <memory>
+#include <random>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 class RGBGameTest : public ::testing::TestWithParam<int> {};
 INSTANTIATE_TEST_SUITE_P(RGBGame, RGBGameTest, ::testing::Range(1, 5));
 
-TEST_P(RGBGameTest, IntegrationTest) {
-  int num_test = GetParam();
+// Opens the input of a test case and reads the output expected for it
+static bool load_test_data(int num_test, std::ifstream &in,
+                           std::string &expected) {
   std::stringstream ss_in, ss_exp;
-
   ss_in << CMAKE_PROJECT_SOURCE_DIR << "/test/data/RGBGame/input_" << num_test
         << ".txt";
   ss_exp << CMAKE_PROJECT_SOURCE_DIR << "/test/data/RGBGame/expected_"
          << num_test << ".txt";
 
-  std::ifstream in(ss_in.str());
+  in.open(ss_in.str());
   std::ifstream exp(ss_exp.str());
-  std::ostringstream expected;
-  expected << exp.rdbuf();
-
   if (!exp.is_open() || !in.is_open()) {
+    return false;
+  }
+  std::ostringstream contents;
+  contents << exp.rdbuf();
+  expected = contents.str();
+  return true;
+}
+
+// Fills a field with balls of the first `colours` colours of R, G and B
+static void random_field(std::mt19937 &generator, std::size_t colours,
+                         char (&field)[FIELD_HEIGHT][FIELD_WIDTH]) {
+  const char balls[] = {'R', 'G', 'B'};
+  std::uniform_int_distribution<std::size_t> colour(0, colours - 1);
+  for (auto &row : field) {
+    for (auto &cell : row) {
+      cell = balls[colour(generator)];
+    }
+  }
+}
+
+// Returns the rows of a random field of the default size, as random_field
+// fills it
+static std::vector<std::string> random_field(std::mt19937 &generator,
+                                             std::size_t colours) {
+  char field[FIELD_HEIGHT][FIELD_WIDTH];
+  random_field(generator, colours, field);
+  std::vector<std::string> rows;
+  for (const auto &row : field) {
+    rows.emplace_back(row, FIELD_WIDTH);
+  }
+  return rows;
+}
+
+TEST_P(RGBGameTest, IntegrationTest) {
+  std::ifstream in;
+  std::string expected;
+  if (!load_test_data(GetParam(), in, expected)) {
+    FAIL() << "Failed to open expected output file";
+  }
+
+  EXPECT_EQ(RGB_Game::handle_rgb_game(in), expected);
+}
+
+TEST_P(RGBGameTest, BitboardMatchesExpected) {
+  std::ifstream in;
+  std::string expected;
+  if (!load_test_data(GetParam(), in, expected)) {
     FAIL() << "Failed to open expected output file";
   }
 
-  EXPECT_EQ(RGB_Game::handle_rgb_game(in), expected.str());
-}
\ No newline at end of file
+  // Play the games as handle_rgb_game does, on the bitboard engine
+  std::stringstream result;
+  std::size_t n;
+  in >> n;
+  for (std::size_t i = 0; i < n; i++) {
+    result << "Game " << i + 1 << ":" << std::endl;
+
+    char field[FIELD_HEIGHT][FIELD_WIDTH];
+    for (std::size_t j = 0; j < FIELD_HEIGHT; j++) {
+      for (std::size_t k = 0; k < FIELD_WIDTH; k++) {
+        in >> field[j][k];
+      }
+    }
+
+    try {
+      RGB_Game::BitboardGame game(field);
+      game.play();
+      result << game.dumps_log() << std::endl;
+    } catch (const std::invalid_argument &e) {
+      result << "Invalid input: " << e.what() << std::endl;
+    }
+  }
+
+  EXPECT_EQ(result.str(), expected);
+}
+
+// Copies the rows of a field of the default size to its cells
+static void to_cells(const std::vector<std::string> &rows,
+                     char (&field)[FIELD_HEIGHT][FIELD_WIDTH]) {
+  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
+    std::memcpy(field[i], rows[i].data(), FIELD_WIDTH);
+  }
+}
+
+/**
+ * @brief An engine which must play greedy games as RGB_Game::play does.
+ *
+ * play returns the record of every field. The batch engine only knows the
+ * final score and the balls remaining, so its records hold no moves and only
+ * those are compared.
+ */
+struct ReferenceEngine {
+  const char *name;
+  std::vector<RGB_Game::GameRecord> (*play)(
+      const std::vector<std::vector<std::string>> &fields);
+  bool records_moves;
+};
+
+static void PrintTo(const ReferenceEngine &engine, std::ostream *os) {
+  *os << engine.name;
+}
+
+static std::vector<RGB_Game::GameRecord> play_bitboard(
+    const std::vector<std::vector<std::string>> &fields) {
+  std::vector<RGB_Game::GameRecord> records;
+  for (const auto &rows : fields) {
+    char field[FIELD_HEIGHT][FIELD_WIDTH];
+    to_cells(rows, field);
+    RGB_Game::BitboardGame game(field);
+    game.play();
+    records.push_back(game.get_record());
+  }
+  return records;
+}
+
+static std::vector<RGB_Game::GameRecord> play_dynamic(
+    const std::vector<std::vector<std::string>> &fields) {
+  std::vector<RGB_Game::GameRecord> records;
+  for (const auto &rows : fields) {
+    auto game = std::make_unique<RGB_Game::DynamicRGBGame>(rows);
+    game->play();
+    records.push_back(game->get_record());
+  }
+  return records;
+}
+
+static std::vector<RGB_Game::GameRecord> play_greedy_strategy(
+    const std::vector<std::vector<std::string>> &fields) {
+  std::vector<RGB_Game::GameRecord> records;
+  for (const auto &rows : fields) {
+    RGB_Game::GreedyStrategy greedy;
+    RGB_Game::RGB_Game game(rows);
+    game.play(greedy);
+    records.push_back(game.get_record());
+  }
+  return records;
+}
+
+static std::vector<RGB_Game::GameRecord> play_session(
+    const std::vector<std::vector<std::string>> &fields) {
+  std::vector<RGB_Game::GameRecord> records;
+  for (const auto &rows : fields) {
+    RGB_Game::GameSession session(rows);
+    RGB_Game::MoveRecord move;
+    while (session.best_move(move)) {
+      session.apply_move(move.row, move.column);
+    }
+    EXPECT_TRUE(session.finished());
+    EXPECT_EQ(session.score(), session.get_record().final_score());
+    records.push_back(session.get_record());
+  }
+  return records;
+}
+
+static std::vector<RGB_Game::GameRecord> play_batch(
+    const std::vector<std::vector<std::string>> &fields) {
+  RGB_Game::BatchGame batch;
+  for (const auto &rows : fields) {
+    char field[FIELD_HEIGHT][FIELD_WIDTH];
+    to_cells(rows, field);
+    batch.add_field(field);
+  }
+  std::vector<RGB_Game::GameRecord> records;
+  for (const auto &result : batch.play()) {
+    records.emplace_back();
+    records.back().finish(result.score, result.balls_remaining);
+  }
+  return records;
+}
+
+class RGBGameReferenceTest : public ::testing::TestWithParam<ReferenceEngine> {
+};
+INSTANTIATE_TEST_SUITE_P(
+    RGBGame, RGBGameReferenceTest,
+    ::testing::Values(ReferenceEngine{"Bitboard", play_bitboard, true},
+                      ReferenceEngine{"Dynamic", play_dynamic, true},
+                      ReferenceEngine{"GreedyStrategy", play_greedy_strategy,
+                                      true},
+                      ReferenceEngine{"Session", play_session, true},
+                      ReferenceEngine{"Batch", play_batch, false}),
+    [](const ::testing::TestParamInfo<ReferenceEngine> &info) {
+      return std::string(info.param.name);
+    });
+
+TEST_P(RGBGameReferenceTest, MatchesRandomGames) {
+  const ReferenceEngine &engine = GetParam();
+  std::mt19937 generator(38);
+
+  // Two colours on some boards, for long games that clear the field. Not a
+  // whole number of batch blocks, so the last block has idle lanes
+  std::vector<std::vector<std::string>> fields;
+  for (std::size_t game = 0; game < 100; game++) {
+    fields.push_back(random_field(generator, 2 + game % 2));
+  }
+
+  std::vector<RGB_Game::GameRecord> records = engine.play(fields);
+  ASSERT_EQ(records.size(), fields.size());
+  for (std::size_t game = 0; game < fields.size(); game++) {
+    RGB_Game::RGB_Game expected(fields[game]);
+    expected.play();
+    const RGB_Game::GameRecord &record = expected.get_record();
+    if (engine.records_moves) {
+      ASSERT_EQ(records[game], record) << "game " << game;
+    } else {
+      ASSERT_EQ(records[game].final_score(), record.final_score())
+          << "game " << game;
+      ASSERT_EQ(records[game].balls_remaining(), record.balls_remaining())
+          << "game " << game;
+    }
+  }
+}
+
+TEST(RGBGameBitboardTest, HashIgnoresMoveOrder) {
+  // A checkerboard with two clusters of three in the bottom rows, far enough
+  // apart for either to be removed first
+  char field[FIELD_HEIGHT][FIELD_WIDTH];
+  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
+    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
+      field[i][j] = (i + j) % 2 ? 'R' : 'G';
+    }
+  }
+  for (std::size_t i = FIELD_HEIGHT - 3; i < FIELD_HEIGHT; i++) {
+    field[i][2] = 'B';
+    field[i][10] = 'B';
+  }
+
+  RGB_Game::BitboardField start(field);
+  std::vector<RGB_Game::BitboardMove> moves;
+  start.list_moves(moves);
+  ASSERT_EQ(moves.size(), 2u);
+
+  RGB_Game::BitboardField first(start), second(start);
+  first.make_move(moves[0]);
+  first.make_move(moves[1]);
+  second.make_move(moves[1]);
+  EXPECT_NE(second.hash(), start.hash());
+  second.make_move(moves[0]);
+  EXPECT_EQ(first.hash(), second.hash());
+  EXPECT_NE(first.hash(), start.hash());
+}
+
+TEST(RGBGameBitboardTest, UndoRestoresField) {
+  std::mt19937 generator(45);
+
+  for (std::size_t game = 0; game < 50; game++) {
+    char field[FIELD_HEIGHT][FIELD_WIDTH];
+    random_field(generator, 2 + game % 2, field);
+
+    // Walk down random moves, undoing every other move on the way, then
+    // walk all the way up
+    RGB_Game::BitboardField board(field);
+    std::vector<RGB_Game::BitboardField> path{board};
+    std::vector<RGB_Game::MoveUndo> undos;
+    std::vector<RGB_Game::BitboardMove> moves;
+    while (board.list_moves(moves), !moves.empty()) {
+      std::uniform_int_distribution<std::size_t> pick(0, moves.size() - 1);
+      const RGB_Game::BitboardMove &move = moves[pick(generator)];
+
+      RGB_Game::MoveUndo undo;
+      board.apply_move(move, undo);
+      board.undo_move(undo);
+      ASSERT_TRUE(board == path.back()) << "game " << game;
+      ASSERT_EQ(board.hash(), path.back().hash());
+
+      undos.emplace_back();
+      board.apply_move(move, undos.back());
+      path.push_back(board);
+    }
+    while (!undos.empty()) {
+      board.undo_move(undos.back());
+      undos.pop_back();
+      path.pop_back();
+      ASSERT_TRUE(board == path.back()) << "game " << game;
+      ASSERT_EQ(board.hash(), path.back().hash());
+    }
+  }
+}
+
+TEST(RGBGameTranspositionTest, StoresAndProbes) {
+  RGB_Game::TranspositionTable table(4);
+  RGB_Game::TranspositionEntry entry;
+  EXPECT_FALSE(table.probe(0, entry));
+  EXPECT_FALSE(table.probe(42, entry));
+
+  table.store(42, {1000, 7});
+  ASSERT_TRUE(table.probe(42, entry));
+  EXPECT_EQ(entry.score, 1000u);
+  EXPECT_EQ(entry.depth, 7u);
+
+  // A key of the same slot replaces the entry
+  EXPECT_FALSE(table.probe(42 + 16, entry));
+  table.store(42 + 16, {5, 1});
+  EXPECT_FALSE(table.probe(42, entry));
+  ASSERT_TRUE(table.probe(42 + 16, entry));
+  EXPECT_EQ(entry.score, 5u);
+}
+
+// Reads the final score from the last line of a game log
+static std::size_t final_score(const std::string &log) {
+  std::size_t start = log.rfind("Final score ") + std::strlen("Final score ");
+  return std::stoul(log.substr(start));
+}
+
+class RGBGameSearchTest
+    : public ::testing::TestWithParam<RGB_Game::SearchStrategy> {};
+INSTANTIATE_TEST_SUITE_P(
+    RGBGame, RGBGameSearchTest,
+    ::testing::Values(RGB_Game::SearchStrategy::Beam,
+                      RGB_Game::SearchStrategy::MonteCarlo));
+
+TEST_P(RGBGameSearchTest, ScoresAtLeastGreedy) {
+  std::mt19937 generator(39);
+
+  RGB_Game::SearchConfig config;
+  config.strategy = GetParam();
+  config.beam_width = 2;
+  config.rollouts = 100;
+  config.time_budget = 0;
+
+  std::size_t greedy_total = 0, search_total = 0;
+  for (std::size_t game = 0; game < 4; game++) {
+    char field[FIELD_HEIGHT][FIELD_WIDTH];
+    random_field(generator, 3, field);
+
+    RGB_Game::BitboardGame greedy(field);
+    greedy.play();
+    RGB_Game::BitboardGame search(field);
+    search.play(config);
+
+    std::size_t greedy_score = final_score(greedy.dumps_log());
+    std::size_t search_score = final_score(search.dumps_log());
+    EXPECT_GE(search_score, greedy_score) << "game " << game;
+    greedy_total += greedy_score;
+    search_total += search_score;
+  }
+  EXPECT_GT(search_total, greedy_total);
+}
+
+TEST(RGBGameSizeTest, PlaysSmallField) {
+  std::stringstream in("1\nRRGG\nRRGG\nBBBB\n");
+  EXPECT_EQ(RGB_Game::handle_rgb_game(in, 3, 4, RGB_Game::SearchConfig()),
+            "Game 1:\n"
+            "Move 1 at (1, 1): removed 4 balls of color B, got 4 points\n"
+            "Move 2 at (1, 1): removed 4 balls of color R, got 4 points\n"
+            "Move 3 at (1, 1): removed 4 balls of color G, got 4 points\n"
+            "Final score 1012 with 0 balls remaining\n\n");
+}
+
+TEST(RGBGameSizeTest, ClearsLargestField) {
+  std::vector<std::string> rows(MAX_FIELD_HEIGHT,
+                                std::string(MAX_FIELD_WIDTH, 'R'));
+  auto game = std::make_unique<RGB_Game::DynamicRGBGame>(rows);
+  game->play();
+  EXPECT_EQ(game->dumps_log(),
+            "Move 1 at (1, 1): removed 4096 balls of color R, got 16760836 "
+            "points\nFinal score 16761836 with 0 balls remaining\n");
+}
+
+TEST(RGBGameSizeTest, RejectsInvalidSizes) {
+  std::stringstream in("0\n");
+  RGB_Game::SearchConfig config;
+  EXPECT_THROW(RGB_Game::handle_rgb_game(in, 0, 4, config),
+               std::invalid_argument);
+  EXPECT_THROW(RGB_Game::handle_rgb_game(in, 4, MAX_FIELD_WIDTH + 1, config),
+               std::invalid_argument);
+  EXPECT_THROW(RGB_Game::RGB_Game(std::vector<std::string>(3, "RGB")),
+               std::invalid_argument);
+
+  // The search only plays fields of the default size
+  std::stringstream search_in("1\nRRR\nGGG\n");
+  config.strategy = RGB_Game::SearchStrategy::Beam;
+  EXPECT_EQ(RGB_Game::handle_rgb_game(search_in, 2, 3, config),
+            "Game 1:\nInvalid input: Search needs a field of the default "
+            "size\n");
+}
+
+// Returns the best points of the moves ahead of a field by trying them all
+static std::size_t exhaustive_points(const RGB_Game::BitboardField &field) {
+  std::vector<RGB_Game::BitboardMove> moves;
+  field.list_moves(moves);
+  std::size_t best = field.count_balls_on_field() == 0 ? CLEAR_BONUS : 0;
+  for (const auto &move : moves) {
+    RGB_Game::BitboardField child = field;
+    child.make_move(move);
+    best = std::max(best, move.points() + exhaustive_points(child));
+  }
+  return best;
+}
+
+TEST(RGBGameEndgameTest, MatchesExhaustiveSearch) {
+  std::mt19937 generator(46);
+
+  RGB_Game::SearchConfig config;
+  config.endgame_threshold = 40;
+  config.endgame_time_budget = 0;
+
+  std::size_t greedy_total = 0, solved_total = 0;
+  for (std::size_t game = 0; game < 10; game++) {
+    char field[FIELD_HEIGHT][FIELD_WIDTH];
+    random_field(generator, 3, field);
+
+    // The solver takes over at the first greedy field below the threshold
+    RGB_Game::BitboardField board(field);
+    RGB_Game::BitboardMove move;
+    std::size_t score = 0;
+    while (board.count_balls_on_field() >= config.endgame_threshold &&
+           board.choose_move(move)) {
+      board.make_move(move);
+      score += move.points();
+    }
+
+    RGB_Game::BitboardGame greedy(field);
+    greedy.play();
+    RGB_Game::BitboardGame solved(field);
+    solved.play(config);
+
+    std::size_t solved_score = final_score(solved.dumps_log());
+    EXPECT_EQ(solved_score, score + exhaustive_points(board))
+        << "game " << game;
+
+    // The solver finds the same points without memoising them
+    RGB_Game::SearchConfig unmemoised = config;
+    unmemoised.transposition_bits = 0;
+    RGB_Game::BitboardGame unmemoised_game(field);
+    unmemoised_game.play(unmemoised);
+    EXPECT_EQ(final_score(unmemoised_game.dumps_log()), solved_score)
+        << "game " << game;
+    greedy_total += final_score(greedy.dumps_log());
+    solved_total += solved_score;
+  }
+  EXPECT_GT(solved_total, greedy_total);
+}
+
+TEST(RGBGameEndgameTest, RejectsTooManyTranspositionBits) {
+  char cells[FIELD_HEIGHT][FIELD_WIDTH];
+  std::memset(cells, 'R', sizeof(cells));
+  RGB_Game::BitboardField field(cells);
+  RGB_Game::SearchConfig config;
+  config.endgame_threshold = 40;
+  config.transposition_bits = MAXIMUM_TRANSPOSITION_BITS + 1;
+  EXPECT_THROW(RGB_Game::plan_moves(field, config), std::invalid_argument);
+  // 64 GiB of slots
+  config.transposition_bits = 32;
+  EXPECT_THROW(RGB_Game::plan_moves(field, config), std::invalid_argument);
+  config.transposition_bits = 64;
+  EXPECT_THROW(RGB_Game::plan_moves(field, config), std::invalid_argument);
+}
+
+TEST(RGBGameBatchTest, RejectsInvalidChar) {
+  char field[FIELD_HEIGHT][FIELD_WIDTH];
+  for (auto &row : field) {
+    for (auto &cell : row) {
+      cell = 'R';
+    }
+  }
+  field[3][4] = 'X';
+  RGB_Game::BatchGame batch;
+  EXPECT_THROW(batch.add_field(field), std::invalid_argument);
+  EXPECT_EQ(batch.size(), 0u);
+}
+
+TEST(RGBGameRecordTest, ReplayRoundTrip) {
+  std::mt19937 generator(48);
+  char field[FIELD_HEIGHT][FIELD_WIDTH];
+  random_field(generator, 2, field);
+
+  RGB_Game::RGB_Game game(field);
+  game.play();
+  const RGB_Game::GameRecord &record = game.get_record();
+  ASSERT_FALSE(record.moves().empty());
+  EXPECT_EQ(record.final_score(), final_score(game.dumps_log()));
+
+  std::string replay = record.dumps_replay();
+  EXPECT_EQ(replay.size(), 4 + 4 + 5 * record.moves().size() + 4 + 2);
+  RGB_Game::GameRecord loaded = RGB_Game::GameRecord::loads_replay(replay);
+  EXPECT_EQ(loaded, record);
+  EXPECT_EQ(loaded.dumps_log(), game.dumps_log());
+
+  RGB_Game::BitboardGame bitboard(field);
+  bitboard.play();
+  EXPECT_EQ(bitboard.get_record(), record);
+
+  EXPECT_THROW(RGB_Game::GameRecord::loads_replay("RGB0"),
+               std::invalid_argument);
+  EXPECT_THROW(RGB_Game::GameRecord::loads_replay(replay.substr(0, 20)),
+               std::invalid_argument);
+  EXPECT_THROW(RGB_Game::GameRecord::loads_replay(replay + '\0'),
+               std::invalid_argument);
+}
+
+// Removes the smallest cluster, the first of them on a tie
+class SmallestStrategy : public RGB_Game::MoveStrategy {
+ public:
+  std::size_t choose(const std::vector<RGB_Game::ClusterMove> &moves) override {
+    std::size_t best = 0;
+    for (std::size_t k = 1; k < moves.size(); k++) {
+      if (moves[k].size < moves[best].size) {
+        best = k;
+      }
+    }
+    return best;
+  }
+};
+
+TEST(RGBGameStrategyTest, ListsMovesAndPlaysStrategies) {
+  char field[FIELD_HEIGHT][FIELD_WIDTH];
+  for (std::size_t i = 0; i < FIELD_HEIGHT; i++) {
+    for (std::size_t j = 0; j < FIELD_WIDTH; j++) {
+      field[i][j] = (i + j) % 2 ? 'R' : 'G';
+    }
+  }
+  // A cluster of 4 in the bottom left, one of 3 after it, and one of 3 in
+  // the top row which no move may remove
+  field[9][0] = field[9][1] = field[8][1] = field[8][2] = 'B';
+  field[9][5] = field[8][5] = field[7][5] = 'B';
+  field[0][10] = field[0][11] = field[0][12] = 'B';
+
+  RGB_Game::RGB_Game game(field);
+  std::vector<RGB_Game::ClusterMove> moves;
+  game.list_moves(moves);
+  ASSERT_EQ(moves.size(), 2u);
+  EXPECT_EQ(moves[0].anchor, RGB_Game::Point(0, 9));
+  EXPECT_EQ(moves[0].colour, 'B');
+  EXPECT_EQ(moves[0].size, 4u);
+  EXPECT_EQ(moves[1].anchor, RGB_Game::Point(5, 9));
+  EXPECT_EQ(moves[1].size, 3u);
+
+  SmallestStrategy smallest;
+  RGB_Game::RGB_Game custom(field);
+  custom.play(smallest);
+  ASSERT_FALSE(custom.get_record().moves().empty());
+  EXPECT_EQ(custom.get_record().moves()[0].column, 6);
+}
+
+TEST(RGBGameSessionTest, AppliesExternalMoves) {
+  RGB_Game::DynamicGameSession session({"RGG", "RRG", "BRG"});
+  RGB_Game::MoveRecord move;
+  ASSERT_TRUE(session.best_move(move));
+  EXPECT_EQ(move.row, 2);
+  EXPECT_EQ(move.column, 1);
+  EXPECT_EQ(move.colour, 'R');
+  EXPECT_EQ(move.removed, 4);
+
+  EXPECT_THROW(session.apply_move(0, 1), std::invalid_argument);
+  EXPECT_THROW(session.apply_move(1, 4), std::invalid_argument);
+  EXPECT_THROW(session.apply_move(1, 1), std::invalid_argument);
+
+  // Any ball of the cluster makes the move
+  session.apply_move(1, 2);
+  EXPECT_EQ(session.score(), 4u);
+  EXPECT_EQ(session.balls_remaining(), 5u);
+  ASSERT_EQ(session.get_record().moves().size(), 1u);
+  EXPECT_EQ(session.get_record().moves()[0].column, 2);
+
+  // The green ball fell next to the green column
+  ASSERT_TRUE(session.best_move(move));
+  EXPECT_EQ(move.row, 1);
+  EXPECT_EQ(move.column, 2);
+  EXPECT_EQ(move.removed, 4);
+  session.apply_move(move.row, move.column);
+  EXPECT_TRUE(session.finished());
+  EXPECT_FALSE(session.best_move(move));
+  EXPECT_EQ(session.get_record().final_score(), 8u);
+  EXPECT_EQ(session.get_record().balls_remaining(), 1u);
+}
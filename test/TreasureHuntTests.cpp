@@ -1,12 +1,78 @@
 #include <gtest/gtest.h>
 
+#include <TreasureHunt/RayCastContext.hpp>
+#include <TreasureHunt/Scene.hpp>
+#include <TreasureHunt/SearchStatistics.hpp>
 #include <TreasureHunt/TreasureHunt.hpp>
+#include <TreasureHunt/WallGrid.hpp>
+#include <TreasureHunt/WallSet.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <sstream>
 #include <fstream>
 
+// Number of calls of the global operator new in the test binary, to check
+// that some code does not allocate
+static std::atomic<std::size_t> allocation_count{0};
+
+void *operator new(std::size_t size) {
+  allocation_count++;
+  if (void *pointer = std::malloc(size ? size : 1)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  allocation_count++;
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+// Appends the walls of input_<num_test> to `walls` and reads its treasure point
+static bool load_input(int num_test, std::vector<Treasure_Hunt::Wall> &walls,
+                       Treasure_Hunt::Point &treasure_point) {
+  std::stringstream ss_in;
+  ss_in << CMAKE_PROJECT_SOURCE_DIR << "/test/data/TreasureHunt/input_" << num_test
+        << ".txt";
+
+  std::ifstream in(ss_in.str());
+  if (!in.is_open()) {
+    return false;
+  }
+
+  std::size_t number_of_walls;
+  in >> number_of_walls;
+  for (std::size_t i = 0; i < number_of_walls; i++) {
+    double x1, y1, x2, y2;
+    in >> x1 >> y1 >> x2 >> y2;
+    walls.emplace_back(x1, y1, x2, y2);
+  }
+  double x, y;
+  in >> x >> y;
+  treasure_point = Treasure_Hunt::Point(x, y);
+  return static_cast<bool>(in);
+}
+
 class TreasureHuntTest : public ::testing::TestWithParam<int> {};
-INSTANTIATE_TEST_SUITE_P(TreasureHunt, TreasureHuntTest, ::testing::Range(1, 12));
+INSTANTIATE_TEST_SUITE_P(TreasureHunt, TreasureHuntTest, ::testing::Range(1, 14));
 
 TEST_P(TreasureHuntTest, IntegrationTest) {
   int num_test = GetParam();
@@ -27,4 +93,515 @@ TEST_P(TreasureHuntTest, IntegrationTest) {
   }
 
   EXPECT_EQ(Treasure_Hunt::handle_treasure_hunt(in), expected.str());
-}
\ No newline at end of file
+}
+
+TEST_P(TreasureHuntTest, SceneMatchesFullSearch) {
+  int num_test = GetParam();
+  std::vector<Treasure_Hunt::Wall> walls;
+  Treasure_Hunt::Point treasure_point(0, 0);
+  if (!load_input(num_test, walls, treasure_point)) {
+    FAIL() << "Failed to read input file";
+  }
+
+  // Add the walls one by one, then remove every other one
+  Treasure_Hunt::Scene scene;
+  std::vector<std::size_t> ids;
+  for (const auto &wall : walls) {
+    ids.push_back(scene.add_wall(wall));
+    EXPECT_EQ(scene.number_of_doors(treasure_point),
+              Treasure_Hunt::calc_number_of_doors(scene.walls(), treasure_point));
+  }
+  for (std::size_t i = 0; i < ids.size(); i += 2) {
+    scene.remove_wall(ids[i]);
+    EXPECT_EQ(scene.number_of_doors(treasure_point),
+              Treasure_Hunt::calc_number_of_doors(scene.walls(), treasure_point));
+  }
+}
+
+// Returns a wall between two random points with integer coordinates on the
+// field boundary, possibly on the same side
+static Treasure_Hunt::Wall random_boundary_wall(std::mt19937 &generator) {
+  std::uniform_int_distribution<int> side(0, 3), offset(0, 100);
+  auto boundary_point = [&](int s) {
+    int t = offset(generator);
+    switch (s) {
+      case 0:
+        return std::pair(t, 0);
+      case 1:
+        return std::pair(0, t);
+      case 2:
+        return std::pair(t, 100);
+      default:
+        return std::pair(100, t);
+    }
+  };
+  auto [x1, y1] = boundary_point(side(generator));
+  auto [x2, y2] = boundary_point(side(generator));
+  return Treasure_Hunt::Wall(x1, y1, x2, y2);
+}
+
+TEST(TreasureHuntSceneTest, MatchesFullSearchOnRandomLayouts) {
+  std::mt19937 generator(34);
+  std::uniform_int_distribution<int> number_of_walls(12, 24), coordinate(1, 98);
+  for (std::size_t layout = 0; layout < 200; layout++) {
+    Treasure_Hunt::Scene scene;
+    std::vector<std::size_t> ids;
+    for (int i = number_of_walls(generator); i > 0; i--) {
+      ids.push_back(scene.add_wall(random_boundary_wall(generator)));
+    }
+    for (std::size_t query = 0; query < 4; query++) {
+      if (query == 2) {
+        scene.remove_wall(ids.front());
+      }
+      Treasure_Hunt::Point treasure_point(coordinate(generator) + 0.5,
+                                          coordinate(generator) + 0.5);
+      ASSERT_EQ(scene.number_of_doors(treasure_point),
+                Treasure_Hunt::calc_number_of_doors(scene.walls(),
+                                                    treasure_point))
+          << "layout " << layout << ", query " << query;
+    }
+  }
+}
+
+TEST(TreasureHuntSceneTest, ExploresRegionsFromEveryParent) {
+  // A region reached on one level from two parent regions must be explored
+  // from both to find the way out
+  const double coordinates[][4] = {
+      {39, 100, 87, 100}, {100, 95, 0, 15}, {83, 0, 100, 66},
+      {0, 23, 57, 100},   {100, 11, 0, 23}, {93, 0, 100, 59},
+      {78, 0, 95, 100},   {89, 0, 59, 100}, {100, 9, 100, 13},
+      {19, 100, 100, 39}, {80, 100, 24, 100}, {49, 100, 0, 3},
+      {12, 100, 0, 26},   {100, 55, 32, 0}, {59, 0, 100, 92},
+      {9, 100, 23, 0}};
+  Treasure_Hunt::Scene scene;
+  for (const auto &[x1, y1, x2, y2] : coordinates) {
+    scene.add_wall(Treasure_Hunt::Wall(x1, y1, x2, y2));
+  }
+  Treasure_Hunt::Point treasure_point(32, 31);
+  EXPECT_EQ(scene.number_of_doors(treasure_point), 6u);
+  EXPECT_EQ(Treasure_Hunt::calc_number_of_doors(scene.walls(), treasure_point),
+            6u);
+}
+
+TEST_P(TreasureHuntTest, DoorPathLeadsOut) {
+  int num_test = GetParam();
+  Treasure_Hunt::FieldConfig config;
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  Treasure_Hunt::Point treasure_point(0, 0);
+  if (!load_input(num_test, walls, treasure_point)) {
+    FAIL() << "Failed to read input file";
+  }
+
+  auto path = Treasure_Hunt::find_door_path(walls, treasure_point, config);
+  auto number_of_doors =
+      Treasure_Hunt::calc_number_of_doors(walls, treasure_point, config);
+  ASSERT_EQ(path.has_value(), number_of_doors.has_value());
+  if (!path) {
+    return;
+  }
+  ASSERT_EQ(path->size(), *number_of_doors);
+
+  // The inner doors are crossed at their centers, the last door is an outer
+  // wall, and every crossing point lies on the line through its wall
+  auto outer_walls = config.outer_walls();
+  for (std::size_t i = 0; i < path->size(); i++) {
+    const auto &door = (*path)[i];
+    bool outer = std::find(outer_walls.begin(), outer_walls.end(),
+                           door.wall) != outer_walls.end();
+    if (i + 1 == path->size()) {
+      EXPECT_TRUE(outer);
+    } else {
+      EXPECT_EQ(door.crossing_point, door.wall.get_center());
+    }
+    EXPECT_NEAR(door.wall.get_distance_with_point(door.crossing_point), 0,
+                1e-6);
+  }
+}
+
+TEST_P(TreasureHuntTest, TranslatedFieldGivesSameAnswer) {
+  int num_test = GetParam();
+  Treasure_Hunt::FieldConfig config;
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  Treasure_Hunt::Point treasure_point(0, 0);
+  if (!load_input(num_test, walls, treasure_point)) {
+    FAIL() << "Failed to read input file";
+  }
+
+  // The same layout on the field [100, 200] x [100, 200]
+  Treasure_Hunt::FieldConfig translated_config;
+  translated_config.field = Treasure_Hunt::Box{100, 100, 200, 200};
+  std::vector<Treasure_Hunt::Wall> translated_walls;
+  for (const auto &wall : walls) {
+    translated_walls.emplace_back(wall.x1() + 100, wall.y1() + 100,
+                                  wall.x2() + 100, wall.y2() + 100);
+  }
+  Treasure_Hunt::Point translated_point(treasure_point.x() + 100,
+                                        treasure_point.y() + 100);
+
+  EXPECT_EQ(Treasure_Hunt::calc_number_of_doors(
+                translated_walls, translated_point, translated_config),
+            Treasure_Hunt::calc_number_of_doors(walls, treasure_point, config));
+}
+
+// Two nested boxes in the middle of a field three times wider than high, out
+// of the default field
+static const char *const NESTED_BOXES_INPUT =
+    "8\n"
+    "110 10 190 10\n110 90 190 90\n110 10 110 90\n190 10 190 90\n"
+    "130 30 170 30\n130 70 170 70\n130 30 130 70\n170 30 170 70\n"
+    "150 50\n";
+
+TEST(TreasureHuntConfigTest, RectangularField) {
+  Treasure_Hunt::FieldConfig config;
+  config.field = Treasure_Hunt::Box{0, 0, 300, 100};
+  std::istringstream input(NESTED_BOXES_INPUT);
+  EXPECT_EQ(Treasure_Hunt::handle_treasure_hunt(input, config),
+            "Number of doors = 3\n");
+
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  walls.emplace_back(100, 0, 100, 100);
+  walls.emplace_back(200, 0, 200, 100);
+  EXPECT_EQ(Treasure_Hunt::calc_number_of_doors(
+                walls, Treasure_Hunt::Point(150, 50), config),
+            1u);
+  EXPECT_EQ(Treasure_Hunt::calc_number_of_doors(
+                walls, Treasure_Hunt::Point(250, 50), config),
+            1u);
+}
+
+TEST(TreasureHuntConfigTest, OtherRays) {
+  Treasure_Hunt::FieldConfig config;
+  config.field = Treasure_Hunt::Box{0, 0, 300, 100};
+
+  // Four rays along the axes still see every side of the boxes
+  config.ray_count = 4;
+  config.phi_step = std::acos(-1) / 2;
+  std::istringstream input(NESTED_BOXES_INPUT);
+  EXPECT_EQ(Treasure_Hunt::handle_treasure_hunt(input, config),
+            "Number of doors = 3\n");
+
+  // Many rays, 1 degree apart
+  config.ray_count = 360;
+  config.phi_step = std::acos(-1) / 180;
+  input.clear();
+  input.str(NESTED_BOXES_INPUT);
+  EXPECT_EQ(Treasure_Hunt::handle_treasure_hunt(input, config),
+            "Number of doors = 3\n");
+}
+
+TEST(TreasureHuntConfigTest, MaximumWalls) {
+  Treasure_Hunt::FieldConfig config;
+  config.field = Treasure_Hunt::Box{0, 0, 300, 100};
+  config.maximum_walls = 8;
+  std::istringstream input(NESTED_BOXES_INPUT);
+  EXPECT_EQ(Treasure_Hunt::handle_treasure_hunt(input, config),
+            "Number of doors = 3\n");
+
+  config.maximum_walls = 7;
+  input.clear();
+  input.str(NESTED_BOXES_INPUT);
+  EXPECT_THROW(Treasure_Hunt::handle_treasure_hunt(input, config),
+               std::invalid_argument);
+}
+
+class TreasureHuntThreadsTest
+    : public ::testing::TestWithParam<std::tuple<int, std::size_t>> {};
+INSTANTIATE_TEST_SUITE_P(TreasureHunt, TreasureHuntThreadsTest,
+                         ::testing::Combine(::testing::Range(1, 14),
+                                            ::testing::Values(std::size_t{4}, std::size_t{0})));
+
+TEST_P(TreasureHuntThreadsTest, MatchesSingleThread) {
+  auto [num_test, thread_count] = GetParam();
+  Treasure_Hunt::FieldConfig config;
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  Treasure_Hunt::Point treasure_point(0, 0);
+  if (!load_input(num_test, walls, treasure_point)) {
+    FAIL() << "Failed to read input file";
+  }
+
+  Treasure_Hunt::SearchStatistics expected_statistics;
+  auto expected_path = Treasure_Hunt::find_door_path(
+      walls, treasure_point, config, &expected_statistics);
+  auto expected_number_of_doors =
+      Treasure_Hunt::calc_number_of_doors(walls, treasure_point, config);
+
+  config.thread_count = thread_count;
+  Treasure_Hunt::SearchStatistics statistics;
+  auto path =
+      Treasure_Hunt::find_door_path(walls, treasure_point, config, &statistics);
+  EXPECT_EQ(Treasure_Hunt::calc_number_of_doors(walls, treasure_point, config),
+            expected_number_of_doors);
+
+  ASSERT_EQ(path.has_value(), expected_path.has_value());
+  if (path) {
+    ASSERT_EQ(path->size(), expected_path->size());
+    for (std::size_t i = 0; i < path->size(); i++) {
+      EXPECT_EQ((*path)[i].wall, (*expected_path)[i].wall);
+      EXPECT_EQ((*path)[i].crossing_point, (*expected_path)[i].crossing_point);
+    }
+  }
+
+  // Everything but the time is counted the same way on any number of threads
+  ASSERT_EQ(statistics.levels.size(), expected_statistics.levels.size());
+  auto total = statistics.total();
+  auto expected_total = expected_statistics.total();
+  EXPECT_EQ(total.positions, expected_total.positions);
+  EXPECT_EQ(total.ray_casts, expected_total.ray_casts);
+  EXPECT_EQ(total.rays, expected_total.rays);
+  EXPECT_EQ(total.intersections, expected_total.intersections);
+  EXPECT_EQ(total.door_intersections, expected_total.door_intersections);
+  EXPECT_EQ(total.regions_explored, expected_total.regions_explored);
+  EXPECT_EQ(total.regions_pruned, expected_total.regions_pruned);
+  EXPECT_EQ(total.doors, expected_total.doors);
+}
+
+TEST(TreasureHuntStatisticsTest, CountsTheSearch) {
+  Treasure_Hunt::FieldConfig config;
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  walls.emplace_back(50, 0, 50, 100);
+  walls.emplace_back(0, 50, 100, 50);
+
+  Treasure_Hunt::SearchStatistics statistics;
+  auto path = Treasure_Hunt::find_door_path(
+      walls, Treasure_Hunt::Point(25, 25), config, &statistics);
+  ASSERT_TRUE(path);
+
+  // One level is searched per door; the treasure region touches the boundary
+  ASSERT_EQ(statistics.levels.size(), path->size());
+  auto total = statistics.total();
+  EXPECT_EQ(total.positions, 1u);
+  EXPECT_EQ(total.ray_casts, 1u);
+  EXPECT_EQ(total.rays, config.ray_count);
+  EXPECT_EQ(total.intersections, config.ray_count * walls.size());
+
+  std::ostringstream json;
+  statistics.write_json(json);
+  EXPECT_NE(json.str().find("\"ray_casts\": 1"), std::string::npos);
+}
+
+// Checks WallSet::intersect_walls against Wall::is_parallel and
+// Wall::intersection_point for every ordered pair of the walls
+static void expect_intersections_match(
+    const std::vector<Treasure_Hunt::Wall> &walls,
+    const Treasure_Hunt::Box &field) {
+  Treasure_Hunt::WallSet wall_set(walls);
+  std::vector<std::size_t> ids(walls.size());
+  for (std::size_t i = 0; i < ids.size(); i++) {
+    ids[i] = i;
+  }
+  std::vector<double> px(walls.size()), py(walls.size());
+  std::vector<unsigned char> kept(walls.size());
+  for (std::size_t i = 0; i < walls.size(); i++) {
+    wall_set.intersect_walls(i, ids.data(), ids.size(), field, px.data(),
+                             py.data(), kept.data());
+    for (std::size_t k = 0; k < walls.size(); k++) {
+      auto expected =
+          Treasure_Hunt::Wall::intersection_point(walls[i], walls[k]);
+      bool expected_kept =
+          !Treasure_Hunt::Wall::is_parallel(walls[i], walls[k]) &&
+          !expected.out_of_field(field);
+      ASSERT_EQ(kept[k], expected_kept) << walls[i] << " " << walls[k];
+      if (!kept[k]) {
+        continue;
+      }
+      if (std::isnan(expected.x())) {
+        EXPECT_TRUE(std::isnan(px[k]) && std::isnan(py[k]));
+      } else {
+        EXPECT_EQ(Treasure_Hunt::Point(px[k], py[k]), expected)
+            << walls[i] << " " << walls[k];
+      }
+    }
+  }
+}
+
+TEST(TreasureHuntExactTest, LineCoefficients) {
+  Treasure_Hunt::ExactLineCoefficients line(Treasure_Hunt::Wall(7, 3, 2, 9));
+  EXPECT_EQ(line.dx, 5);
+  EXPECT_EQ(line.dy, -6);
+  EXPECT_EQ(line.cross, 7 * 9 - 3 * 2);
+  EXPECT_EQ(line.dx_abs, 5);
+  EXPECT_EQ(line.squared_length, 61);
+}
+
+TEST(TreasureHuntExactTest, MatchesDoublePath) {
+  // Integer walls of the field, degenerate ones included, and walls which
+  // reach out of it
+  Treasure_Hunt::FieldConfig config;
+  std::mt19937 generator(32);
+  std::uniform_int_distribution<int> coordinate(-20, 120);
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  walls.emplace_back(10, 10, 10, 10);
+  walls.emplace_back(30, 40, 30, 40);
+  walls.emplace_back(0, 50, 100, 50);
+  walls.emplace_back(20, 50, 80, 50);
+  for (int i = 0; i < 60; i++) {
+    walls.emplace_back(coordinate(generator), coordinate(generator),
+                       coordinate(generator), coordinate(generator));
+  }
+  expect_intersections_match(walls, config.field);
+}
+
+TEST(TreasureHuntExactTest, ConcurrentWallsGiveOnePoint) {
+  // Three walls through (1.4, 0.6), which is not a double: every pair gives
+  // the same rounding of it, so the point is deduplicated by the door search
+  std::vector<Treasure_Hunt::Wall> walls = {
+      Treasure_Hunt::Wall(0, 0, 7, 3), Treasure_Hunt::Wall(0, 2, 2, 0),
+      Treasure_Hunt::Wall(0, 3, 7, -9)};
+  Treasure_Hunt::Box field{0, 0, 100, 100};
+  expect_intersections_match(walls, field);
+
+  Treasure_Hunt::WallSet wall_set(walls);
+  std::size_t ids[] = {1, 2};
+  double px[2], py[2];
+  unsigned char kept[2];
+  wall_set.intersect_walls(0, ids, 2, field, px, py, kept);
+  ASSERT_TRUE(kept[0] && kept[1]);
+  EXPECT_EQ(px[0], px[1]);
+  EXPECT_EQ(py[0], py[1]);
+  wall_set.intersect_walls(1, ids + 1, 1, field, px + 1, py + 1, kept + 1);
+  ASSERT_TRUE(kept[1]);
+  EXPECT_EQ(px[0], px[1]);
+  EXPECT_EQ(py[0], py[1]);
+  EXPECT_NEAR(px[0], 1.4, 1e-12);
+  EXPECT_NEAR(py[0], 0.6, 1e-12);
+}
+
+TEST(TreasureHuntExactTest, LargeCoordinatesFallBack) {
+  // Coordinates above the exact limit take the double path
+  Treasure_Hunt::FieldConfig config;
+  config.field = Treasure_Hunt::Box{0, 0, 1000, 1000};
+  std::mt19937 generator(33);
+  std::uniform_int_distribution<int> coordinate(0, 1000);
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  walls.emplace_back(300, 0, 300, 1000);
+  for (int i = 0; i < 40; i++) {
+    walls.emplace_back(coordinate(generator), coordinate(generator),
+                       coordinate(generator), coordinate(generator));
+  }
+  expect_intersections_match(walls, config.field);
+}
+
+TEST(TreasureHuntRayTest, CastRayMatchesIntersectionPoint) {
+  // Mostly walls which miss the rays, so that the single precision screen of
+  // the float screen build rejects whole blocks, with walls close to the
+  // rays, to the field and to being parallel among them
+  Treasure_Hunt::FieldConfig config;
+  std::mt19937 generator(37);
+  std::uniform_real_distribution<double> coordinate(-50, 150);
+  std::uniform_real_distribution<double> nudge(-1e-6, 1e-6);
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  for (int i = 0; i < 300; i++) {
+    double x = coordinate(generator), y = coordinate(generator);
+    switch (i % 4) {
+      case 0:
+        walls.emplace_back(x, y, coordinate(generator), coordinate(generator));
+        break;
+      case 1:
+        walls.emplace_back(x, y, x + 1, y + 1 + nudge(generator));
+        break;
+      case 2:
+        walls.emplace_back(std::round(x), std::round(y), std::round(x) + 3,
+                           std::round(y) - 2);
+        break;
+      default:
+        walls.emplace_back(x, y, x + nudge(generator), y + 0.5);
+        break;
+    }
+  }
+  Treasure_Hunt::WallSet wall_set(walls);
+
+  std::uniform_real_distribution<double> position(0, 100);
+  std::vector<double> px(walls.size()), py(walls.size());
+  std::vector<unsigned char> kept(walls.size());
+  for (int i = 0; i < 200; i++) {
+    double x = position(generator), y = position(generator);
+    double phi = i;
+    Treasure_Hunt::Wall ray(x, y, x + config.ray_length() * std::cos(phi),
+                            y + config.ray_length() * std::sin(phi));
+    wall_set.cast_ray(ray, config.field, px.data(), py.data(), kept.data());
+
+    Treasure_Hunt::Box ray_box{std::min(ray.x1(), ray.x2()),
+                               std::min(ray.y1(), ray.y2()),
+                               std::max(ray.x1(), ray.x2()),
+                               std::max(ray.y1(), ray.y2())};
+    for (std::size_t k = 0; k < walls.size(); k++) {
+      auto expected = Treasure_Hunt::Wall::intersection_point(walls[k], ray);
+      bool expected_kept = !Treasure_Hunt::Wall::is_parallel(walls[k], ray) &&
+                           !expected.out_of_field(config.field) &&
+                           !expected.out_of_field(ray_box);
+      ASSERT_EQ(kept[k], expected_kept) << walls[k] << " " << ray;
+      if (kept[k]) {
+        EXPECT_EQ(Treasure_Hunt::Point(px[k], py[k]), expected)
+            << walls[k] << " " << ray;
+      }
+    }
+  }
+}
+
+TEST(TreasureHuntRayTest, GridMatchesFullScanWithZeroLengthWalls) {
+  // The zero-length wall is kept with a NaN intersection by every ray of the
+  // full scan; the grid must give the same nearest walls without falling
+  // back to it
+  Treasure_Hunt::FieldConfig config;
+  std::mt19937 generator(28);
+  for (std::size_t point_id : {std::size_t{0}, std::size_t{50}}) {
+    std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+    while (walls.size() < 200) {
+      walls.push_back(random_boundary_wall(generator));
+    }
+    walls.insert(walls.begin() + point_id, Treasure_Hunt::Wall(30, 40, 30, 40));
+    Treasure_Hunt::WallSet wall_set(walls);
+    Treasure_Hunt::WallGrid wall_grid(wall_set, config.field);
+    Treasure_Hunt::RayCastContext grid_cast(wall_set, config, &wall_grid);
+    Treasure_Hunt::RayCastContext full_cast(wall_set, config);
+
+    std::uniform_real_distribution<double> position(1, 99);
+    for (int i = 0; i < 20; i++) {
+      Treasure_Hunt::Point casting_point(position(generator),
+                                         position(generator));
+      ASSERT_EQ(grid_cast.cast(casting_point), full_cast.cast(casting_point))
+          << "zero-length wall " << point_id << ", " << casting_point;
+      const auto &grid_hits = grid_cast.ray_hits();
+      const auto &full_hits = full_cast.ray_hits();
+      for (std::size_t r = 0; r < grid_hits.size(); r++) {
+        EXPECT_EQ(grid_hits[r].found, full_hits[r].found);
+        EXPECT_EQ(grid_hits[r].wall, full_hits[r].wall);
+        EXPECT_EQ(grid_hits[r].last_wall, full_hits[r].last_wall);
+      }
+    }
+
+    // A full scan intersects the ray with every wall
+    EXPECT_LT(grid_cast.counters().intersections,
+              full_cast.counters().intersections);
+  }
+}
+
+TEST(TreasureHuntRayTest, CastDoesNotAllocateAfterWarmUp) {
+  Treasure_Hunt::FieldConfig config;
+  std::mt19937 generator(30);
+  std::vector<Treasure_Hunt::Wall> walls = config.outer_walls();
+  while (walls.size() < 200) {
+    walls.push_back(random_boundary_wall(generator));
+  }
+  walls.emplace_back(30, 40, 30, 40);
+  Treasure_Hunt::WallSet wall_set(walls);
+  Treasure_Hunt::WallGrid wall_grid(wall_set, config.field);
+
+  // With the full scans and with the grid
+  for (bool use_grid : {false, true}) {
+    Treasure_Hunt::RayCastContext context(wall_set, config,
+                                          use_grid ? &wall_grid : nullptr);
+    std::uniform_real_distribution<double> position(1, 99);
+    for (int i = 0; i < 10; i++) {
+      context.cast(Treasure_Hunt::Point(position(generator),
+                                        position(generator)));
+    }
+
+    std::size_t allocations = allocation_count;
+    for (int i = 0; i < 100; i++) {
+      context.cast(Treasure_Hunt::Point(position(generator),
+                                        position(generator)));
+    }
+    EXPECT_EQ(allocation_count, allocations) << (use_grid ? "grid" : "full scan");
+  }
+}